@@ -35,39 +35,105 @@ class Joystick
 {
 public:
 	Joystick( const char* device );
+
+	// Wraps a file descriptor that's already open in non-blocking mode and delivers js_event 
+	// records, such as the read end of a pipe. This is mostly useful to simulate devices. 
+	// The joystick takes ownership of the file descriptor. The numbers of axes and buttons 
+	// are capped to what the joystick driver supports (64 axes and 512 buttons).
+	Joystick( int fileDescriptor, const char* name, std::size_t numAxes, std::size_t numButtons );
+
 	virtual ~Joystick();
 	bool                    isValid() const;
 
 	const std::string&      getDeviceName() const               { return mDeviceName; }
 	int                     getDriverVersion() const            { return mDriverVersion; }
 	const std::string&      getName() const                     { return mName; }
+	int                     getFileDescriptor() const           { return mJoystickHandle; }     // For waiting on the device with poll() and the like
 
 
-	std::size_t             getNumAxes() const                  { return mAxisValues.size(); }
+	std::size_t             getNumAxes() const                  { return mNumAxes; }
 	short int               getAxisValue( std::size_t axisIndex ) const;    // Returns the axis value in the range [-32767..32767]
 
-	std::size_t             getNumButtons() const               { return mButtonValues.size(); }
+	std::size_t             getNumButtons() const               { return mNumButtons; }
 	bool                    getButtonValue( std::size_t buttonIndex ) const;
 
 	bool                    update();       // Returns false if the joystick couldn't be read (device wasn't opened, or closed abruptly, etc...)
+	unsigned int            getNumEventsRead() const            { return mNumEventsRead; }      // Since the joystick was created, wraps around
 
 	std::string             toString() const;
 
+	// Writes the state of the joystick into a caller supplied buffer, without allocating memory.
+	// TextFormat is the same as toString(). JsonFormat is a single line object. CsvFormat is a single 
+	// line with the device, name, driver version, number of axes, axis values, number of buttons 
+	// and button values. JSON and CSV don't end with a new line.
+	// Like snprintf(), the output is truncated to fit and null terminated (unless bufferSize is 0), 
+	// and the returned value is the length of the full output without the null character.
+	enum Format
+	{
+		TextFormat,
+		JsonFormat,
+		CsvFormat
+	};
+	std::size_t             toString( char* buffer, std::size_t bufferSize, Format format ) const;
+
+	// Listeners are notified of every axis and button event read from the device, 
+	// including the initial state events sent by the kernel when the device is opened.
+	// The time is the event timestamp in milliseconds as provided by the driver. 
+	// It wraps around every 2^32 ms.
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+		virtual void onAxisChanged( Joystick* joystick, std::size_t axisIndex, short int value, unsigned int timeInMs ) {}
+		virtual void onButtonChanged( Joystick* joystick, std::size_t buttonIndex, bool value, unsigned int timeInMs ) {}
+	};
+
+	void                    addListener( Listener* listener );
+	bool                    removeListener( Listener* listener );
+
+	// Converts a time of the monotonic clock in milliseconds (TimerScheduler::getTimeAsNanoseconds() / 1000000) 
+	// to the timebase of the event timestamps, which the driver takes from its own clock. The offset between 
+	// both clocks is estimated from the times the events are read at, and gets more accurate as events come in.
+	// Returns false until an event has been read.
+	bool                    getEventTime( unsigned long long timeInMs, unsigned int& eventTimeInMs ) const;
+
 protected:
 	friend class JoystickManager;
 	static bool             getJoystickInfo( int handle, int& driverVersion, std::string& name, char& numAxes, char& numButtons );
+	bool                    open( const char* device );
+	void                    close();
+	bool                    reopen( const char* device );
 	bool                    processEvents();
 	void                    processEvent( const js_event& event );
+	void                    updateEventTimeOffset( unsigned int eventTime, unsigned long long readTime );
 	void                    setAxisValue( std::size_t axisIndex, short int value );
 	void                    setButtonValue( std::size_t buttonIndex, bool value );
+	void                    setNumAxesAndButtons( std::size_t numAxes, std::size_t numButtons );
 
 private:
 	std::string             mDeviceName;
 	int                     mJoystickHandle;
 	int                     mDriverVersion;
 	std::string             mName;
-	std::vector<short int>  mAxisValues;
-	std::vector<bool>       mButtonValues;
+
+	// The axis and button values are stored inline, so they're part of the JoystickPool 
+	// block and creating a joystick doesn't allocate them. The sizes are the joystick 
+	// driver limits (ABS_CNT axes, KEY_MAX - BTN_MISC + 1 buttons)
+	static const std::size_t mMaxNumAxes = 64;
+	static const std::size_t mMaxNumButtons = 512;
+	std::size_t             mNumAxes;
+	short int               mAxisValues[mMaxNumAxes];
+	std::size_t             mNumButtons;
+	unsigned char           mButtonValues[mMaxNumButtons / 8];     // One bit per button
+	unsigned int            mNumEventsRead;
+	static const unsigned int mMaxEventTimeOffsetDecayInMs = 1000;
+	bool                    mHasEventTimeOffset;
+	unsigned int            mEventTimeOffset;       // Event time minus monotonic time, wraps around
+	unsigned long long      mEventTimeOffsetTime;   // When the offset was last raised
+
+	// Listeners
+	typedef std::vector<Listener*>  Listeners;
+	Listeners               mListeners;
 };
 
 }
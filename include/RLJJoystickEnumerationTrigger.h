@@ -25,6 +25,8 @@
 
 #include <vector>
 
+#include "RLJTimerScheduler.h"
+
 namespace RLJ
 {
 
@@ -39,26 +41,54 @@ class JoystickEnumerationTrigger
 public:
 	virtual~ JoystickEnumerationTrigger() {}
 	virtual bool enumerationNeeded() = 0;
+
+	// Creates a trigger firing every interval and driven the same way as this one. 
+	// The JoystickManager uses it to probe for lost joysticks more often. 
+	// Defaults to a TimeBasedEnumerationTrigger.
+	virtual JoystickEnumerationTrigger* createTrigger( unsigned int intervalInMs ) const;
 };
 
 /*
 	TimeBasedEnumerationTrigger
+
+	Fires every interval, based on the monotonic clock
 */
 class TimeBasedEnumerationTrigger : public JoystickEnumerationTrigger
 {
 public:
 	TimeBasedEnumerationTrigger( unsigned int intervalInMs );
 	virtual bool        enumerationNeeded();
+	virtual JoystickEnumerationTrigger* createTrigger( unsigned int intervalInMs ) const;
 
 private:
-	static unsigned int mInitialSecond;
-	static unsigned int getTimeAsMilliseconds();
+	static unsigned long long getTimeAsMilliseconds();
 	
-	int                 updateNextTime();
+	long long           updateNextTime();
 
 	unsigned int        mIntervalInMs;
-	unsigned int        mStartTime;
-	unsigned int        mNextTime;
+	unsigned long long  mStartTime;
+	unsigned long long  mNextTime;
 };	
 
+/*
+	TimerEnumerationTrigger
+
+	Fires every interval, as a task of a TimerScheduler. This lets the caller 
+	wait on the scheduler file descriptor, instead of waking up regularly to 
+	check whether an enumeration is needed. The scheduler must outlive the trigger.
+*/
+class TimerEnumerationTrigger : public JoystickEnumerationTrigger, public TimerScheduler::Task
+{
+public:
+	TimerEnumerationTrigger( TimerScheduler& scheduler, unsigned int intervalInMs );
+	virtual ~TimerEnumerationTrigger();
+	virtual bool        enumerationNeeded();
+	virtual JoystickEnumerationTrigger* createTrigger( unsigned int intervalInMs ) const;
+	virtual void        run( TimerScheduler* scheduler );
+
+private:
+	TimerScheduler&     mScheduler;
+	bool                mEnumerationNeeded;
+};
+
 }
\ No newline at end of file
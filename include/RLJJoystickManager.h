@@ -26,11 +26,15 @@
 #include <vector>
 #include <string>
 
+#include "RLJJoystick.h"
+#include "RLJJoystickPool.h"
+#include "RLJJoystickPollScheduler.h"
+
 namespace RLJ
 {
 
-class Joystick;
 class JoystickEnumerationTrigger;
+class ShardedJoystickUpdater;
 
 class JoystickManager
 {
@@ -39,24 +43,94 @@ public:
 	// will be monitored on a regular interval. If a device appears a Joystick object 
 	// will be automatically created. If it disappears it will be removed.
 	// The more names to monitor, the more expensive the enumeration is.
-	JoystickManager( const std::vector<std::string>& deviceNames );
+	// maxNumSimulatedJoysticks reserves room for joysticks added with addSimulatedJoystick().
+	JoystickManager( const std::vector<std::string>& deviceNames, std::size_t maxNumSimulatedJoysticks=0 );
 
 	// Same as above except that the list is constructed from a root name suffixed with 
 	// a value going from 0 to numDevices-1. 
-	JoystickManager( const char* deviceNameRoot, unsigned int numDevices );
+	JoystickManager( const char* deviceNameRoot, unsigned int numDevices, std::size_t maxNumSimulatedJoysticks=0 );
+
+	// Adds a joystick reading js_event records from a file descriptor, such as the read end of 
+	// a pipe (see the corresponding Joystick constructor), to simulate a device. It's handled like 
+	// the other joysticks, except that enumeration ignores it: it's only lost when reading fails 
+	// (the write end is closed...). The joystick takes ownership of the file descriptor. 
+	// Returns a null handle, leaving the file descriptor open, if there's no room left.
+	JoystickHandle  addSimulatedJoystick( int fileDescriptor, const char* name, std::size_t numAxes, std::size_t numButtons );
 
 	virtual ~JoystickManager();
 
-	const std::vector<Joystick*>& getJoysticks() const { return mJoysticks; }
+	// The joysticks are listed in the order of their slots in the pool, which is their order in memory.
+	// The Joystick pointers are only valid until the joystick disconnects. 
+	// To refer to a joystick beyond that, keep its handle instead: once the joystick
+	// is gone, getJoystick() returns NULL for it.
+	const std::vector<Joystick*>&       getJoysticks() const        { return mJoysticks; }
+	const std::vector<JoystickHandle>&  getJoystickHandles() const  { return mJoystickHandles; }
+	Joystick*                           getJoystick( const JoystickHandle& handle ) const   { return mJoystickPool->get(handle); }
+	JoystickHandle                      getJoystickHandle( const Joystick* joystick ) const { return mJoystickPool->getHandle(joystick); }
 
 	void        update();
 	void        updateEnumeration();
 
+	// Replaces what decides when update() enumerates the devices in full rate polling mode, 
+	// by default a TimeBasedEnumerationTrigger firing every 2 seconds. For instance, a 
+	// TimerEnumerationTrigger lets the caller wait on a TimerScheduler file descriptor. 
+	// The more frequent probing for lost joysticks uses a trigger of the same kind (see 
+	// JoystickEnumerationTrigger::createTrigger()), so that file descriptor also wakes the 
+	// caller up for it. The manager takes ownership of the trigger.
+	void        setEnumerationTrigger( JoystickEnumerationTrigger* trigger );
+
+	// With more than one thread, update() reads the joysticks in parallel (see ShardedJoystickUpdater). 
+	// It still returns once all of them have been read, and joysticks are still added, removed and 
+	// reattached on the calling thread, but the Joystick listeners are then called from the update threads.
+	// The default of 1 reads them one after the other on the calling thread.
+	void        setNumUpdateThreads( std::size_t numThreads );
+	std::size_t getNumUpdateThreads() const;
+
+	// Writes the state of every joystick into a caller supplied buffer, without allocating memory.
+	// Each joystick is written as with Joystick::toString() and followed by a new line, so JSON and 
+	// CSV give one line per joystick. Returns the length of the full output, like Joystick::toString().
+	std::size_t dumpJoysticks( char* buffer, std::size_t bufferSize, Joystick::Format format ) const;
+
+	// FullRatePolling (the default) reads every joystick on every update() and enumerates 
+	// the devices every 2 seconds. AdaptivePolling reads and enumerates less and less often 
+	// while there's no input, and goes back to full rate on the first event (see JoystickPollScheduler).
+	// In adaptive mode, update() does nothing when called before getTimeUntilNextUpdate() has elapsed, 
+	// so the caller can save wakeups by sleeping until then. A caller that also waits on the joystick 
+	// file descriptors calls requestUpdate() when one becomes readable, so the next update() reads 
+	// the joysticks right away.
+	enum PollingMode
+	{
+		FullRatePolling,
+		AdaptivePolling
+	};
+	void            setPollingMode( PollingMode mode );
+	PollingMode     getPollingMode() const                                  { return mPollingMode; }
+	void            setAdaptivePollingSettings( const JoystickPollScheduler::Settings& settings );
+	const JoystickPollScheduler::Settings& getAdaptivePollingSettings() const { return mPollScheduler.getSettings(); }
+	bool            isIdle() const;
+	unsigned int    getTimeUntilNextUpdate() const;                         // In ms. Always 0 in full rate mode, where the caller picks its own rate
+	void            requestUpdate();
+
+	// A joystick whose device disappears (unplugged, flaky cable...) is first considered lost: 
+	// it reports neutral values but stays in the list, and the devices are then probed every 
+	// 100 ms instead of every 2 seconds. If the same device (same name, and same physical 
+	// location and unique id when available) comes back within the grace period, it's reattached 
+	// to the same Joystick object and listeners get onJoystickReconnected(). Otherwise the joystick 
+	// is removed (onJoystickDisconnecting()), and if its device comes back later, it's added as 
+	// a new joystick (onJoystickConnected()).
+	// The default grace period of 0 never reattaches: a lost joystick is removed at the next probe.
+	void            setReconnectGracePeriod( unsigned int gracePeriodInMs ) { mReconnectGracePeriodInMs = gracePeriodInMs; }
+	unsigned int    getReconnectGracePeriod() const                         { return mReconnectGracePeriodInMs; }
+
+	// The joystick is passed as a handle, which is what should be kept to refer to it later: 
+	// a Joystick pointer would silently point to another joystick once its slot is reused. 
+	// getJoystick() resolves the handle, including in onJoystickDisconnecting().
 	class Listener
 	{
 	public:
-		virtual void onJoystickConnected( JoystickManager* joystickManager, Joystick* joystick ) {}
-		virtual void onJoystickDisconnecting( JoystickManager* joystickManager, Joystick* joystick ) {}
+		virtual void onJoystickConnected( JoystickManager* joystickManager, const JoystickHandle& handle ) {}
+		virtual void onJoystickDisconnecting( JoystickManager* joystickManager, const JoystickHandle& handle ) {}
+		virtual void onJoystickReconnected( JoystickManager* joystickManager, const JoystickHandle& handle ) {}
 	};
 
 	void        addListener( Listener* listener );
@@ -65,24 +139,50 @@ public:
 private:
 	struct JoystickIdentifier
 	{
+		JoystickIdentifier() : mSimulated(false) {}
 		std::string mDeviceName;
 		std::string mName;
+		std::string mPhys;
+		std::string mUniq;
+		bool        mSimulated;
 		bool operator==( const JoystickIdentifier& other ) const;
 		bool operator!=( const JoystickIdentifier& other ) const;
+		bool isSameDevice( const JoystickIdentifier& other ) const;
 	};
 
 	static bool getJoystickIdentifier( const char* deviceName, JoystickIdentifier& identifier );
+	static std::string readSysfsAttribute( const char* path );
+	static unsigned long long getTimeAsMilliseconds();
 	static int  getJoystickIdentifierIndex( const std::vector<JoystickIdentifier>& identifiers, const JoystickIdentifier& identifier );
+	static bool isDeviceNameTaken( const std::vector<JoystickIdentifier>& identifiers, const JoystickIdentifier& identifier );
+
+	void        initializeJoystickStorage( std::size_t maxNumSimulatedJoysticks );
 
 	void        addJoystick( const JoystickIdentifier& identifier );
+	void        insertJoystick( const JoystickIdentifier& identifier, const JoystickHandle& handle );
+
+	void        removeJoystick( std::size_t index );
 
-	void        removeJoystick(const JoystickIdentifier& identifier );
+	bool        hasLostJoysticks() const;
+	void        markJoystickLost( std::size_t index, unsigned long long currentTime );
+	bool        isInGracePeriod( std::size_t index, unsigned long long currentTime ) const;
+	int         getLostJoystickIndex( const JoystickIdentifier& identifier, unsigned long long currentTime ) const;
+	bool        reattachJoystick( std::size_t index, const JoystickIdentifier& identifier );
 
 	static const unsigned int           mEnumerationIntervalInMs = 2000;
 	JoystickEnumerationTrigger*         mEnumerationTrigger;
+	static const unsigned int           mReattachIntervalInMs = 100;
+	JoystickEnumerationTrigger*         mReattachTrigger;
+	unsigned int                        mReconnectGracePeriodInMs;
+	PollingMode                         mPollingMode;
+	JoystickPollScheduler               mPollScheduler;
+	ShardedJoystickUpdater*             mShardedUpdater;
 	std::vector<std::string>            mJoystickDeviceNames;
+	JoystickPool*                       mJoystickPool;
 	std::vector<Joystick*>              mJoysticks;
+	std::vector<JoystickHandle>         mJoystickHandles;
 	std::vector<JoystickIdentifier>     mJoystickIdentifiers;
+	std::vector<unsigned long long>     mJoystickLostTimes;
 
 	// Listeners
 	typedef std::vector<Listener*>      Listeners;
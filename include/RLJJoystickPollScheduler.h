@@ -0,0 +1,82 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#pragma once
+
+namespace RLJ
+{
+
+/*
+	JoystickPollScheduler
+
+	Decides when the joysticks should be read and when the devices should be 
+	enumerated, based on input activity. While there's activity, joysticks are 
+	read at the active poll interval. Once there's been no event for the idle 
+	timeout, the poll interval doubles after each read without event, up to the 
+	idle poll interval, and enumeration slows down to the idle enumeration 
+	interval. The first event brings everything back to the active rates.
+
+	Times are in milliseconds from an arbitrary monotonic origin, on 64 bits so they don't wrap.
+*/
+class JoystickPollScheduler
+{
+public:
+	struct Settings
+	{
+		Settings();
+		unsigned int    mActivePollIntervalInMs;            // 0 means on every update, at the caller's own rate
+		unsigned int    mIdlePollIntervalInMs;              // Longest interval between two reads when idle
+		unsigned int    mIdleTimeoutInMs;                   // Time without event before being idle
+		unsigned int    mActiveEnumerationIntervalInMs;
+		unsigned int    mIdleEnumerationIntervalInMs;
+	};
+
+	JoystickPollScheduler( unsigned long long currentTime, const Settings& settings=Settings() );
+
+	const Settings&     getSettings() const                 { return mSettings; }
+	void                setSettings( const Settings& settings, unsigned long long currentTime );
+
+	bool                isIdle( unsigned long long currentTime ) const;
+	bool                isPollDue( unsigned long long currentTime ) const         { return currentTime>=mNextPollTime; }
+	bool                isEnumerationDue( unsigned long long currentTime ) const  { return currentTime>=mNextEnumerationTime; }
+
+	// To be called after reading the joysticks and after enumerating respectively
+	void                onPolled( unsigned long long currentTime, bool activity );
+	void                onEnumerated( unsigned long long currentTime );
+
+	// Makes a read due right away, for instance when the caller knows that a device has 
+	// pending events because it waits on the device file descriptors
+	void                requestPoll( unsigned long long currentTime )             { mNextPollTime = currentTime; }
+
+	// The time left until the next read or enumeration is due, 0 if one is due already
+	unsigned int        getTimeUntilNextUpdate( unsigned long long currentTime ) const;
+
+private:
+	Settings            mSettings;
+	unsigned long long  mLastActivityTime;
+	unsigned int        mPollIntervalInMs;
+	unsigned long long  mNextPollTime;
+	unsigned long long  mNextEnumerationTime;
+};
+
+}
@@ -0,0 +1,108 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace RLJ
+{
+
+class Joystick;
+
+/*
+	JoystickHandle
+
+	Refers to a Joystick stored in a JoystickPool. Unlike a Joystick pointer, 
+	a handle can be kept around safely after the joystick has been destroyed: 
+	the pool detects that it's stale (its generation doesn't match the slot's 
+	anymore) and resolves it to NULL, even if the slot has since been reused 
+	for another joystick.
+	A default constructed handle is null and never refers to any joystick.
+*/
+struct JoystickHandle
+{
+	JoystickHandle() : mIndex(0), mGeneration(0) {}
+	JoystickHandle( unsigned int index, unsigned int generation ) : mIndex(index), mGeneration(generation) {}
+
+	bool isNull() const { return mGeneration==0; }
+	bool operator==( const JoystickHandle& other ) const { return mIndex==other.mIndex && mGeneration==other.mGeneration; }
+	bool operator!=( const JoystickHandle& other ) const { return !(*this==other); }
+
+	unsigned int mIndex;
+	unsigned int mGeneration;
+};
+
+/*
+	JoystickPool
+
+	Fixed capacity storage for Joystick objects. The joysticks live in a single 
+	contiguous block allocated at construction, so creating and destroying 
+	joysticks doesn't allocate the Joystick objects nor their axis and button 
+	values, which update() then reads from that block. The slots of destroyed 
+	joysticks are reused by the next ones. The device name and name strings are 
+	still allocated when they're too long for the small string buffer.
+*/
+class JoystickPool
+{
+public:
+	JoystickPool( std::size_t capacity );
+	virtual ~JoystickPool();
+
+	std::size_t         getCapacity() const                 { return mCapacity; }
+	std::size_t         getNumJoysticks() const             { return mCapacity - mFreeIndices.size(); }
+
+	// Return a null handle if the pool is full. See the Joystick constructors
+	JoystickHandle      create( const char* device );
+	JoystickHandle      create( int fileDescriptor, const char* name, std::size_t numAxes, std::size_t numButtons );
+	
+	// Returns false if the handle is stale
+	bool                destroy( const JoystickHandle& handle );
+	void                destroyAll();
+
+	// Returns NULL if the handle is stale
+	Joystick*           get( const JoystickHandle& handle ) const;
+	bool                isValid( const JoystickHandle& handle ) const       { return get(handle)!=NULL; }
+
+	// Returns a null handle if the joystick is not a live one of this pool
+	JoystickHandle      getHandle( const Joystick* joystick ) const;
+
+	// Direct access to the slots, for iterating over the live joysticks in memory order.
+	// getJoystickAt() returns NULL for a free slot.
+	Joystick*           getJoystickAt( std::size_t index ) const;
+
+private:
+	JoystickPool( const JoystickPool& );
+	std::size_t         takeFreeIndex();
+	JoystickHandle      makeLive( std::size_t index );
+
+	JoystickPool& operator=( const JoystickPool& );
+
+	std::size_t                 mCapacity;
+	Joystick*                   mJoysticks;
+	std::vector<unsigned int>   mGenerations;       // Odd when the slot holds a live joystick
+	std::vector<std::size_t>    mFreeIndices;
+};
+
+}
@@ -0,0 +1,122 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#pragma once
+
+#include "RLJJoystick.h"
+
+#include <vector>
+
+namespace RLJ
+{
+
+/*
+	JoystickResampler
+
+	Records the axis and button events of a Joystick in a bounded history, 
+	and answers what the value of each axis and button was at a given time.
+	This lets a fixed-rate control loop sample the joystick at its exact tick 
+	times, rather than getting whatever value was last seen when update() 
+	happened to be called.
+
+	Register it as a listener of the Joystick. Times are in the timebase of 
+	the driver event timestamps (milliseconds, wrapping every 2^32 ms). The 
+	tick times of a control loop on the monotonic clock (such as one driven 
+	by a TimerScheduler) are converted to it with Joystick::getEventTime().
+
+	All memory is allocated at construction. Recording events and querying 
+	values never allocate: when the history of an axis or button is full, 
+	its oldest entry is overwritten.
+*/
+class JoystickResampler : public Joystick::Listener
+{
+public:
+	enum Interpolation
+	{
+		Hold,           // Value of the last event at or before the time
+		Linear          // Linear interpolation between the events around the time
+	};
+
+	JoystickResampler( std::size_t numAxes, std::size_t numButtons, std::size_t historySize );
+	virtual ~JoystickResampler();
+
+	std::size_t             getNumAxes() const                  { return mAxisHistories.size(); }
+	std::size_t             getNumButtons() const               { return mButtonHistories.size(); }
+	std::size_t             getHistorySize() const              { return mHistorySize; }
+
+	void                    addAxisValue( std::size_t axisIndex, short int value, unsigned int timeInMs );
+	void                    addButtonValue( std::size_t buttonIndex, bool value, unsigned int timeInMs );
+	void                    clear();
+
+	// A time before the oldest recorded event returns the oldest recorded value.
+	// An axis or button with no recorded event returns 0 / false.
+	short int               getAxisValue( std::size_t axisIndex, unsigned int timeInMs, Interpolation interpolation=Hold ) const;
+	bool                    getButtonValue( std::size_t buttonIndex, unsigned int timeInMs ) const;
+
+	// Samples every axis and button at each of the numTimes times. 
+	// axisValues must hold numTimes*getNumAxes() values and buttonValues 
+	// numTimes*getNumButtons() values. They are filled one tick after the other: 
+	// the values for times[i] start at axisValues[i*getNumAxes()] and 
+	// buttonValues[i*getNumButtons()]. Either array can be NULL to skip it.
+	void                    sample( const unsigned int* timesInMs, std::size_t numTimes, 
+									short int* axisValues, bool* buttonValues, Interpolation interpolation=Hold ) const;
+
+	// Joystick::Listener
+	virtual void            onAxisChanged( Joystick* joystick, std::size_t axisIndex, short int value, unsigned int timeInMs );
+	virtual void            onButtonChanged( Joystick* joystick, std::size_t buttonIndex, bool value, unsigned int timeInMs );
+
+private:
+	struct Event
+	{
+		unsigned int    mTime;
+		short int       mValue;
+	};
+
+	// Fixed capacity ring buffer of events ordered by time
+	class History
+	{
+	public:
+		History();
+		void            setCapacity( std::size_t capacity );
+		void            clear()                             { mStart = 0; mSize = 0; }
+		std::size_t     size() const                        { return mSize; }
+		const Event&    operator[]( std::size_t index ) const   { return mEvents[(mStart+index) % mEvents.size()]; }
+		const Event&    back() const                        { return (*this)[mSize-1]; }
+		void            push( unsigned int time, short int value );
+		std::size_t     findLastAtOrBefore( unsigned int time ) const;
+
+	private:
+		std::vector<Event>  mEvents;
+		std::size_t         mStart;
+		std::size_t         mSize;
+	};
+
+	static bool             isBefore( unsigned int time1, unsigned int time2 );
+	static short int        getValue( const History& history, unsigned int timeInMs, Interpolation interpolation );
+
+	std::size_t             mHistorySize;
+	std::vector<History>    mAxisHistories;
+	std::vector<History>    mButtonHistories;
+};
+
+}
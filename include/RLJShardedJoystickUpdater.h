@@ -0,0 +1,113 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+
+namespace RLJ
+{
+
+class Joystick;
+
+/*
+	ShardedJoystickUpdater
+
+	Updates a set of joysticks using a small pool of threads. On each update(), 
+	the joysticks are split into one shard per thread. A thread first updates 
+	the joysticks of its own shard, then steals the ones not yet started in 
+	the other shards, so a slow device only holds back the thread it's on.
+
+	Each joystick is updated by exactly one thread, which publishes the outcome 
+	in the results. update() returns once every shard is done, so the caller 
+	gets all the joysticks and results from the same frame.
+
+	The joystick listeners are called from the pool threads. The joysticks 
+	mustn't be used by other threads while update() is running.
+*/
+class ShardedJoystickUpdater
+{
+public:
+	// The calling thread takes part in the work, so numThreads-1 threads are created
+	ShardedJoystickUpdater( std::size_t numThreads );
+	virtual ~ShardedJoystickUpdater();
+
+	std::size_t         getNumThreads() const               { return mNumShards; }
+
+	struct Result
+	{
+		bool            mReadFailed;            // The joystick was valid but update() returned false
+		unsigned int    mNumEventsRead;
+	};
+
+	// Afterwards, getResults() has one entry per joystick, in the same order. 
+	// The results storage is kept from one update to the next
+	void                update( const std::vector<Joystick*>& joysticks );
+	const std::vector<Result>& getResults() const           { return mResults; }
+
+private:
+	ShardedJoystickUpdater( const ShardedJoystickUpdater& );
+	ShardedJoystickUpdater& operator=( const ShardedJoystickUpdater& );
+
+	// Each shard is alone on its cache line, to avoid false sharing between the threads taking 
+	// joysticks from different shards. The padding makes it a full line, and the shards are 
+	// allocated aligned on a line, which std::vector doesn't guarantee before C++17
+	static const std::size_t mCacheLineSize = 64;
+	struct Shard
+	{
+		std::size_t     mBegin;
+		std::size_t     mEnd;
+		std::size_t     mNext;
+		char            mPadding[mCacheLineSize - 3 * sizeof(std::size_t)];
+	};
+	typedef char        ShardSizeCheck[ sizeof(Shard)==mCacheLineSize ? 1 : -1 ];     // Fails to compile if a shard isn't one line
+
+	struct Thread
+	{
+		ShardedJoystickUpdater* mUpdater;
+		std::size_t     mShardIndex;
+		pthread_t       mThread;
+	};
+
+	static void*        threadEntry( void* data );
+	void                runThread( std::size_t shardIndex );
+	void                processShards( std::size_t shardIndex );
+	static void         updateJoystick( Joystick* joystick, Result& result );
+
+	Shard*                      mShards;
+	std::size_t                 mNumShards;
+	std::vector<Thread>         mThreads;
+	Joystick* const*            mJoysticks;
+	std::vector<Result>         mResults;
+
+	pthread_mutex_t             mMutex;
+	pthread_cond_t              mStartCondition;
+	pthread_cond_t              mDoneCondition;
+	unsigned int                mFrame;
+	std::size_t                 mNumShardsDone;
+	bool                        mQuit;
+};
+
+}
@@ -0,0 +1,94 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#pragma once
+
+#include <vector>
+
+namespace RLJ
+{
+
+/*
+	TimerScheduler
+
+	Runs periodic tasks (enumeration, statistics flush, resync checks...) off a 
+	single timerfd on the monotonic clock, so clock adjustments don't affect them 
+	and their timing doesn't wrap around.
+	
+	The file descriptor becomes readable when a task is due. It can be waited 
+	on with poll() or epoll along with the joystick file descriptors, and 
+	dispatch() called when it's readable. dispatch() can also simply be called 
+	regularly, using getTimeUntilNextTask() to know when.
+	
+	A task that is late (dispatch() wasn't called in time) runs once, and its 
+	next run stays aligned on its period.
+*/
+class TimerScheduler
+{
+public:
+	class Task
+	{
+	public:
+		virtual ~Task() {}
+		virtual void run( TimerScheduler* scheduler ) = 0;
+	};
+
+	TimerScheduler();
+	virtual ~TimerScheduler();
+	bool                isValid() const;
+	int                 getFileDescriptor() const               { return mTimerHandle; }
+
+	// The first run happens one period after the task is added. 
+	// Tasks mustn't be added or removed from within Task::run().
+	bool                addTask( Task* task, unsigned int periodInMs );
+	bool                removeTask( Task* task );
+
+	// Runs the tasks that are due. Returns the number of tasks that ran
+	std::size_t         dispatch();
+	
+	// In milliseconds, 0 if a task is already due, clamped to INT_MAX. Returns -1 if there's no task
+	int                 getTimeUntilNextTask() const;
+
+	static unsigned long long getTimeAsNanoseconds();
+
+private:
+	TimerScheduler( const TimerScheduler& );
+	TimerScheduler& operator=( const TimerScheduler& );
+
+	struct ScheduledTask
+	{
+		Task*               mTask;
+		unsigned long long  mPeriodInNs;
+		unsigned long long  mStartTime;
+		unsigned long long  mNextTime;
+	};
+
+	bool                getNextTime( unsigned long long& nextTime ) const;
+	void                armTimer();
+
+	int                         mTimerHandle;
+	std::vector<ScheduledTask>  mTasks;
+	bool                        mDispatching;
+};
+
+}
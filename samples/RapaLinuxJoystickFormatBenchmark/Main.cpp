@@ -0,0 +1,130 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystick.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/joystick.h>
+
+/*
+	Compares Joystick::toString() with the allocation-free Joystick::toString( buffer... ) 
+	variants on a simulated joystick fed through a pipe, counting the calls to operator new
+*/
+
+static unsigned long numAllocations = 0;
+
+void* operator new( std::size_t size )
+{
+	++numAllocations;
+	void* memory = malloc( size>0 ? size : 1 );
+	if ( !memory )
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete( void* memory ) noexcept
+{
+	free( memory );
+}
+
+void operator delete( void* memory, std::size_t ) noexcept
+{
+	free( memory );
+}
+
+static const int numIterations = 200000;
+
+static double getTimeInS()
+{
+	struct timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return time.tv_sec + time.tv_nsec / 1000000000.0;
+}
+
+static void report( const char* name, double duration, unsigned long allocations, std::size_t length )
+{
+	printf("%-22s %12.1f %18.2f %10lu\n", name, duration * 1000000000.0 / numIterations, 
+		static_cast<double>(allocations) / numIterations, static_cast<unsigned long>(length));
+}
+
+int main( int argc, char** argv )
+{
+	int fileDescriptors[2];
+	if ( pipe2( fileDescriptors, O_NONBLOCK )!=0 )
+	{
+		printf("Can't create pipe\n");
+		return 1;
+	}
+	RLJ::Joystick joystick( fileDescriptors[0], "Simulated \"Pro\" joystick, rev 2", 8, 16 );
+
+	// Give every axis and button a value
+	for ( int i=0; i<24; ++i )
+	{
+		js_event event;
+		memset( &event, 0, sizeof(event) );
+		event.type = i<8 ? JS_EVENT_AXIS : JS_EVENT_BUTTON;
+		event.number = i<8 ? i : i-8;
+		event.value = i<8 ? (i-4) * 8000 : i % 2;
+		if ( write( fileDescriptors[1], &event, sizeof(event) )!=sizeof(event) )
+			return 1;
+	}
+	joystick.update();
+
+	char buffer[2048];
+	std::string reference = joystick.toString();
+	joystick.toString( buffer, sizeof(buffer), RLJ::Joystick::TextFormat );
+	printf("Text output %s toString()\n", reference==buffer ? "matches" : "DOES NOT match");
+	joystick.toString( buffer, sizeof(buffer), RLJ::Joystick::JsonFormat );
+	printf("%s\n", buffer);
+	joystick.toString( buffer, sizeof(buffer), RLJ::Joystick::CsvFormat );
+	printf("%s\n\n", buffer);
+
+	printf("%-22s %12s %18s %10s\n", "", "ns/call", "allocations/call", "length");
+
+	std::size_t length = 0;
+	unsigned long allocations = numAllocations;
+	double startTime = getTimeInS();
+	for ( int i=0; i<numIterations; ++i )
+		length += joystick.toString().size();
+	report( "toString()", getTimeInS() - startTime, numAllocations - allocations, length / numIterations );
+
+	const char* names[] = { "toString(buffer) text", "toString(buffer) json", "toString(buffer) csv" };
+	for ( int format=RLJ::Joystick::TextFormat; format<=RLJ::Joystick::CsvFormat; ++format )
+	{
+		length = 0;
+		allocations = numAllocations;
+		startTime = getTimeInS();
+		for ( int i=0; i<numIterations; ++i )
+			length += joystick.toString( buffer, sizeof(buffer), static_cast<RLJ::Joystick::Format>(format) );
+		report( names[format], getTimeInS() - startTime, numAllocations - allocations, length / numIterations );
+	}
+
+	close( fileDescriptors[1] );
+	return 0;
+}
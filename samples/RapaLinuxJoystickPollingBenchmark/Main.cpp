@@ -0,0 +1,208 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystick.h"
+#include "RLJJoystickManager.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <linux/joystick.h>
+
+/*
+	Measures the wakeups per second while idle and the latency of the first 
+	event after an idle period, for each polling mode of a JoystickManager 
+	holding simulated joysticks fed through pipes:
+	- full rate: the caller calls update() every 2 ms (a 500 Hz loop)
+	- adaptive: the caller sleeps for getTimeUntilNextUpdate() between updates
+	- adaptive+poll: same, but the caller also waits on the joystick file 
+	  descriptors and calls requestUpdate() when one is readable
+	The adaptive modes use the default settings, except for a 1 second idle 
+	timeout to keep the trials short.
+*/
+
+static const int numJoysticks = 4;
+static const int numTrials = 5;
+static const unsigned int fullRateIntervalInMs = 2;
+static const unsigned int idleTimeoutInMs = 1000;
+
+enum Mode
+{
+	FullRate,
+	Adaptive,
+	AdaptiveWithPoll
+};
+
+static long long getTimeInUs()
+{
+	struct timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return static_cast<long long>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+}
+
+struct Injection
+{
+	int         mFileDescriptor;
+	unsigned int mDelayInUs;
+	long long   mWriteTime;
+};
+
+static void* injectEvent( void* data )
+{
+	Injection* injection = static_cast<Injection*>(data);
+	usleep( injection->mDelayInUs );
+	js_event event;
+	memset( &event, 0, sizeof(event) );
+	event.time = static_cast<unsigned int>( getTimeInUs() / 1000 );
+	event.value = 1000;
+	event.type = JS_EVENT_AXIS;
+	event.number = 0;
+	injection->mWriteTime = getTimeInUs();
+	if ( write( injection->mFileDescriptor, &event, sizeof(event) )!=sizeof(event) )
+		printf("Can't write event\n");
+	return NULL;
+}
+
+static unsigned int getNumEventsRead( const RLJ::JoystickManager& manager )
+{
+	unsigned int numEventsRead = 0;
+	const std::vector<RLJ::Joystick*>& joysticks = manager.getJoysticks();
+	for ( std::size_t i=0; i<joysticks.size(); ++i )
+		numEventsRead += joysticks[i]->getNumEventsRead();
+	return numEventsRead;
+}
+
+static void runTrial( Mode mode, RLJ::JoystickManager& manager, int writeFileDescriptor, 
+					  double& wakeupsPerSecond, double& latencyInMs )
+{
+	// Start each trial active, as after an event
+	RLJ::JoystickPollScheduler::Settings settings;
+	settings.mIdleTimeoutInMs = idleTimeoutInMs;
+	manager.setPollingMode( mode==FullRate ? RLJ::JoystickManager::FullRatePolling : RLJ::JoystickManager::AdaptivePolling );
+	manager.setAdaptivePollingSettings( settings );
+
+	pollfd pollFileDescriptors[numJoysticks];
+	const std::vector<RLJ::Joystick*>& joysticks = manager.getJoysticks();
+	for ( std::size_t i=0; i<joysticks.size(); ++i )
+	{
+		pollFileDescriptors[i].fd = joysticks[i]->getFileDescriptor();
+		pollFileDescriptors[i].events = POLLIN;
+	}
+
+	// Inject an event at a random time, well after going idle. Wakeups are counted once 
+	// the polling has had time to back off
+	Injection injection;
+	injection.mFileDescriptor = writeFileDescriptor;
+	injection.mDelayInUs = 3 * idleTimeoutInMs * 1000 + rand() % 1000000;
+	injection.mWriteTime = 0;
+	pthread_t thread;
+	pthread_create( &thread, NULL, injectEvent, &injection );
+
+	long long countStartTime = getTimeInUs() + 2 * idleTimeoutInMs * 1000;
+	unsigned int numWakeups = 0;
+	unsigned int numEventsRead = getNumEventsRead( manager );
+	long long readTime = 0;
+	while ( readTime==0 )
+	{
+		if ( getTimeInUs()>=countStartTime )
+			++numWakeups;
+
+		manager.update();
+		if ( getNumEventsRead( manager )!=numEventsRead )
+		{
+			readTime = getTimeInUs();
+			break;
+		}
+
+		if ( mode==FullRate )
+		{
+			usleep( fullRateIntervalInMs * 1000 );
+		}
+		else if ( mode==Adaptive )
+		{
+			usleep( manager.getTimeUntilNextUpdate() * 1000 );
+		}
+		else
+		{
+			int timeout = static_cast<int>( manager.getTimeUntilNextUpdate() );
+			if ( poll( pollFileDescriptors, joysticks.size(), timeout )>0 )
+				manager.requestUpdate();
+		}
+	}
+	pthread_join( thread, NULL );
+
+	double idleDurationInS = static_cast<double>(injection.mWriteTime - countStartTime) / 1000000.0;
+	wakeupsPerSecond = numWakeups / idleDurationInS;
+	latencyInMs = static_cast<double>(readTime - injection.mWriteTime) / 1000.0;
+}
+
+int main( int argc, char** argv )
+{
+	srand( 1 );
+
+	// No device to enumerate, only simulated joysticks
+	RLJ::JoystickManager manager( std::vector<std::string>(), numJoysticks );
+	std::vector<int> writeFileDescriptors;
+	for ( int i=0; i<numJoysticks; ++i )
+	{
+		int fileDescriptors[2];
+		if ( pipe2( fileDescriptors, O_NONBLOCK )!=0 )
+		{
+			printf("Can't create pipe\n");
+			return 1;
+		}
+		manager.addSimulatedJoystick( fileDescriptors[0], "Simulated joystick", 6, 12 );
+		writeFileDescriptors.push_back( fileDescriptors[1] );
+	}
+
+	const char* modeNames[] = { "full rate", "adaptive", "adaptive+poll" };
+	printf("%d simulated joysticks, %d trials per mode, idle timeout %u ms\n", numJoysticks, numTrials, idleTimeoutInMs);
+	printf("%-16s %18s %22s %22s\n", "mode", "idle wakeups/s", "first event avg (ms)", "first event max (ms)");
+	for ( int mode=FullRate; mode<=AdaptiveWithPoll; ++mode )
+	{
+		double totalWakeupsPerSecond = 0;
+		double totalLatency = 0;
+		double maxLatency = 0;
+		for ( int i=0; i<numTrials; ++i )
+		{
+			double wakeupsPerSecond = 0;
+			double latencyInMs = 0;
+			runTrial( static_cast<Mode>(mode), manager, writeFileDescriptors[i % numJoysticks], wakeupsPerSecond, latencyInMs );
+			totalWakeupsPerSecond += wakeupsPerSecond;
+			totalLatency += latencyInMs;
+			if ( latencyInMs>maxLatency )
+				maxLatency = latencyInMs;
+		}
+		printf("%-16s %18.1f %22.2f %22.2f\n", modeNames[mode], totalWakeupsPerSecond / numTrials, totalLatency / numTrials, maxLatency);
+	}
+
+	for ( std::size_t i=0; i<writeFileDescriptors.size(); ++i )
+		close( writeFileDescriptors[i] );
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystick.h"
+#include "RLJJoystickResampler.h"
+#include "RLJTimerScheduler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/joystick.h>
+
+/*
+	Checks a JoystickResampler, first fed directly with timestamps going 
+	across the 2^32 ms wrap around and more events than its history holds, 
+	then fed by a joystick simulated through a pipe whose event timestamps 
+	are on their own clock, sampled at monotonic tick times.
+*/
+
+static int numFailures = 0;
+
+static void check( bool condition, const char* description )
+{
+	printf("%s %s\n", condition ? "ok  " : "FAIL", description);
+	if ( !condition )
+		++numFailures;
+}
+
+static unsigned long long getTimeInMs()
+{
+	return RLJ::TimerScheduler::getTimeAsNanoseconds() / 1000000;
+}
+
+static bool writeEvent( int fileDescriptor, unsigned char type, unsigned char number, short int value, unsigned int timeInMs )
+{
+	js_event event;
+	memset( &event, 0, sizeof(event) );
+	event.time = timeInMs;
+	event.value = value;
+	event.type = type;
+	event.number = number;
+	return write( fileDescriptor, &event, sizeof(event) )==sizeof(event);
+}
+
+static void checkHistory()
+{
+	// Six events 10 ms apart, the wrap around happening between the 4th and the 5th. 
+	// The history only holds 4, so the first two are overwritten
+	const unsigned int startTime = 0xFFFFFFE0;
+	RLJ::JoystickResampler resampler( 1, 1, 4 );
+	for ( unsigned int i=0; i<6; ++i )
+		resampler.addAxisValue( 0, static_cast<short int>(i*100), startTime + i*10 );
+	resampler.addButtonValue( 0, true, startTime + 10 );
+	resampler.addButtonValue( 0, false, startTime + 40 );
+
+	check( resampler.getAxisValue( 0, startTime + 5 )==200, "before the history, the oldest value left" );
+	check( resampler.getAxisValue( 0, startTime + 25 )==200, "hold before the wrap around" );
+	check( resampler.getAxisValue( 0, startTime + 35 )==300, "hold across the wrap around" );
+	check( resampler.getAxisValue( 0, startTime + 35, RLJ::JoystickResampler::Linear )==350, "linear across the wrap around" );
+	check( resampler.getAxisValue( 0, startTime + 45, RLJ::JoystickResampler::Linear )==450, "linear after the wrap around" );
+	check( resampler.getAxisValue( 0, startTime + 1000, RLJ::JoystickResampler::Linear )==500, "after the history, the latest value" );
+	check( resampler.getButtonValue( 0, startTime + 20 ), "button pressed before the wrap around" );
+	check( !resampler.getButtonValue( 0, startTime + 45 ), "button released after the wrap around" );
+
+	unsigned int times[3] = { startTime + 20, startTime + 35, startTime + 60 };
+	short int axisValues[3];
+	bool buttonValues[3];
+	resampler.sample( times, 3, axisValues, buttonValues, RLJ::JoystickResampler::Linear );
+	check( axisValues[0]==200 && axisValues[1]==350 && axisValues[2]==500, "sampled axis values" );
+	check( buttonValues[0] && buttonValues[1] && !buttonValues[2], "sampled button values" );
+}
+
+static void checkSimulatedJoystick()
+{
+	int fileDescriptors[2];
+	if ( pipe2( fileDescriptors, O_NONBLOCK )!=0 )
+	{
+		check( false, "pipe creation" );
+		return;
+	}
+	RLJ::Joystick joystick( fileDescriptors[0], "Simulated joystick", 1, 0 );
+	RLJ::JoystickResampler resampler( joystick.getNumAxes(), joystick.getNumButtons(), 64 );
+	joystick.addListener( &resampler );
+
+	unsigned int eventTime = 0;
+	check( !joystick.getEventTime( getTimeInMs(), eventTime ), "no event time conversion before the first event" );
+
+	// The simulated driver clock wraps around 100 ms from now
+	const unsigned int numEvents = 10;
+	const unsigned int eventIntervalInMs = 20;
+	unsigned int clockOffset = 0u - static_cast<unsigned int>( getTimeInMs() ) - 100;
+	
+	// The first event is read late, which the later ones make up for
+	unsigned long long writeTimes[numEvents];
+	for ( unsigned int i=0; i<numEvents; ++i )
+	{
+		writeTimes[i] = getTimeInMs();
+		writeEvent( fileDescriptors[1], JS_EVENT_AXIS, 0, static_cast<short int>(i*1000), static_cast<unsigned int>(writeTimes[i]) + clockOffset );
+		if ( i==0 )
+			usleep( 10 * 1000 );
+		joystick.update();
+		usleep( eventIntervalInMs * 1000 );
+	}
+
+	unsigned long long currentTime = getTimeInMs();
+	bool converted = joystick.getEventTime( currentTime, eventTime );
+	int error = static_cast<int>( eventTime - (static_cast<unsigned int>(currentTime) + clockOffset) );
+	printf("     event time conversion error: %d ms\n", error);
+	check( converted && error>=-2 && error<=2, "event time conversion within 2 ms" );
+
+	// Sample halfway between the events, at monotonic tick times
+	unsigned int tickTimes[numEvents];
+	for ( unsigned int i=0; i<numEvents; ++i )
+		joystick.getEventTime( writeTimes[i] + eventIntervalInMs / 2, tickTimes[i] );
+	short int axisValues[numEvents];
+	resampler.sample( tickTimes, numEvents, axisValues, NULL );
+	bool sampled = true;
+	for ( unsigned int i=0; i<numEvents; ++i )
+		sampled = sampled && axisValues[i]==static_cast<short int>(i*1000);
+	check( sampled, "values sampled at monotonic tick times, across the wrap around" );
+
+	joystick.removeListener( &resampler );
+	close( fileDescriptors[1] );
+}
+
+int main( int argc, char** argv )
+{
+	checkHistory();
+	checkSimulatedJoystick();
+	printf("%s\n", numFailures==0 ? "All checks passed" : "Some checks failed");
+	return numFailures==0 ? 0 : 1;
+}
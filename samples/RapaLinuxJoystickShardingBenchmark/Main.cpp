@@ -0,0 +1,136 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystick.h"
+#include "RLJShardedJoystickUpdater.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/joystick.h>
+
+/*
+	Measures how the time to update many simulated joysticks (fed through pipes) 
+	scales with the number of threads of a ShardedJoystickUpdater.
+	Usage: RapaLinuxJoystickShardingBenchmark [maxThreads] [numJoysticks] [numEventsPerFrame]
+	maxThreads defaults to the number of online cores.
+*/
+
+static const int numFrames = 300;
+
+static double getTimeInS()
+{
+	struct timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return time.tv_sec + time.tv_nsec / 1000000000.0;
+}
+
+// Queues events on every simulated joystick, as if each had been moved since the last frame
+static void feedJoysticks( const std::vector<int>& writeFileDescriptors, int numEventsPerFrame, int frame )
+{
+	std::vector<js_event> events( numEventsPerFrame );
+	for ( int i=0; i<numEventsPerFrame; ++i )
+	{
+		memset( &events[i], 0, sizeof(js_event) );
+		events[i].time = frame;
+		events[i].type = JS_EVENT_AXIS;
+		events[i].number = i % 4;
+		events[i].value = static_cast<short int>( (frame * 37 + i * 1000) % 32767 );
+	}
+	for ( std::size_t i=0; i<writeFileDescriptors.size(); ++i )
+	{
+		ssize_t size = numEventsPerFrame * sizeof(js_event);
+		if ( write( writeFileDescriptors[i], &events[0], size )!=size )
+			printf("Can't write events\n");
+	}
+}
+
+int main( int argc, char** argv )
+{
+	int maxThreads = argc>1 ? atoi( argv[1] ) : static_cast<int>( sysconf( _SC_NPROCESSORS_ONLN ) );
+	int numJoysticks = argc>2 ? atoi( argv[2] ) : 48;
+	int numEventsPerFrame = argc>3 ? atoi( argv[3] ) : 16;
+	if ( maxThreads<1 )
+		maxThreads = 1;
+
+	std::vector<RLJ::Joystick*> joysticks;
+	std::vector<int> writeFileDescriptors;
+	for ( int i=0; i<numJoysticks; ++i )
+	{
+		int fileDescriptors[2];
+		if ( pipe2( fileDescriptors, O_NONBLOCK )!=0 )
+		{
+			printf("Can't create pipe\n");
+			return 1;
+		}
+		joysticks.push_back( new RLJ::Joystick( fileDescriptors[0], "Simulated joystick", 4, 8 ) );
+		writeFileDescriptors.push_back( fileDescriptors[1] );
+	}
+
+	printf("%d simulated joysticks, %d events each per frame, %d frames, %ld online cores\n", 
+		numJoysticks, numEventsPerFrame, numFrames, sysconf( _SC_NPROCESSORS_ONLN ));
+	printf("%-10s %16s %10s\n", "threads", "us/frame", "speedup");
+
+	// Reference: one joystick after the other, as JoystickManager does by default
+	double serialTime = 0;
+	for ( int frame=0; frame<numFrames; ++frame )
+	{
+		feedJoysticks( writeFileDescriptors, numEventsPerFrame, frame );
+		double startTime = getTimeInS();
+		for ( std::size_t i=0; i<joysticks.size(); ++i )
+			joysticks[i]->update();
+		serialTime += getTimeInS() - startTime;
+	}
+	printf("%-10s %16.1f %10.2f\n", "serial", serialTime * 1000000.0 / numFrames, 1.0);
+
+	for ( int numThreads=1; numThreads<=maxThreads; ++numThreads )
+	{
+		RLJ::ShardedJoystickUpdater updater( numThreads );
+		double time = 0;
+		unsigned int numEventsRead = 0;
+		for ( int frame=0; frame<numFrames; ++frame )
+		{
+			feedJoysticks( writeFileDescriptors, numEventsPerFrame, frame );
+			double startTime = getTimeInS();
+			updater.update( joysticks );
+			time += getTimeInS() - startTime;
+			const std::vector<RLJ::ShardedJoystickUpdater::Result>& results = updater.getResults();
+			for ( std::size_t i=0; i<results.size(); ++i )
+				numEventsRead += results[i].mNumEventsRead;
+		}
+		if ( numEventsRead!=static_cast<unsigned int>(numFrames * numJoysticks * numEventsPerFrame) )
+			printf("Missed events: %u read\n", numEventsRead);
+		printf("%-10d %16.1f %10.2f\n", numThreads, time * 1000000.0 / numFrames, serialTime / time);
+	}
+
+	for ( std::size_t i=0; i<joysticks.size(); ++i )
+	{
+		delete joysticks[i];
+		close( writeFileDescriptors[i] );
+	}
+	return 0;
+}
@@ -23,6 +23,8 @@
 */
 #include "RLJJoystick.h"
 
+#include "RLJTimerScheduler.h"
+
 #include <assert.h>
 #include <cstring>   // for memset
 #include <fcntl.h>
@@ -31,19 +33,166 @@
 #include <sstream>
 #include <errno.h>
 #include <stdio.h>
+#include <algorithm>
 
 namespace RLJ
 {
 
+// File local, so it can't clash with a class of the same name in the application
+namespace
+{
+
+/*
+	StateWriter
+
+	Appends text to a fixed size buffer with snprintf() semantics
+*/
+class StateWriter
+{
+public:
+	StateWriter( char* buffer, std::size_t bufferSize )
+		: mBuffer(buffer),
+		  mBufferSize(bufferSize),
+		  mLength(0)
+	{
+	}
+
+	void write( char c )
+	{
+		if ( mLength+1<mBufferSize )
+			mBuffer[mLength] = c;
+		++mLength;
+	}
+
+	void write( const char* text )
+	{
+		for ( ; *text; ++text )
+			write( *text );
+	}
+
+	void write( long value )
+	{
+		char digits[24];
+		std::size_t numDigits = 0;
+		unsigned long absoluteValue = value<0 ? -static_cast<unsigned long>(value) : static_cast<unsigned long>(value);
+		do
+		{
+			digits[numDigits++] = static_cast<char>( '0' + absoluteValue % 10 );
+			absoluteValue /= 10;
+		}
+		while ( absoluteValue>0 );
+		if ( value<0 )
+			write( '-' );
+		while ( numDigits>0 )
+			write( digits[--numDigits] );
+	}
+
+	void writeJsonString( const std::string& text )
+	{
+		static const char* hexDigits = "0123456789abcdef";
+		write( '"' );
+		for ( std::size_t i=0; i<text.size(); ++i )
+		{
+			unsigned char c = static_cast<unsigned char>( text[i] );
+			if ( c=='"' || c=='\\' )
+			{
+				write( '\\' );
+				write( static_cast<char>(c) );
+			}
+			else if ( c<0x20 )
+			{
+				write( "\\u00" );
+				write( hexDigits[c >> 4] );
+				write( hexDigits[c & 0xF] );
+			}
+			else
+			{
+				write( static_cast<char>(c) );
+			}
+		}
+		write( '"' );
+	}
+
+	void writeCsvString( const std::string& text )
+	{
+		bool quoted = text.find_first_of( ",\"\r\n" )!=std::string::npos;
+		if ( quoted )
+			write( '"' );
+		for ( std::size_t i=0; i<text.size(); ++i )
+		{
+			if ( text[i]=='"' )
+				write( '"' );
+			write( text[i] );
+		}
+		if ( quoted )
+			write( '"' );
+	}
+
+	std::size_t finish()
+	{
+		if ( mBufferSize>0 )
+			mBuffer[ mLength<mBufferSize ? mLength : mBufferSize-1 ] = '\0';
+		return mLength;
+	}
+
+private:
+	char*           mBuffer;
+	std::size_t     mBufferSize;
+	std::size_t     mLength;
+};
+
+}
+
+/*
+	Joystick
+*/
+
 Joystick::Joystick( const char* device )
 	: mDeviceName(device),
 	  mJoystickHandle(-1),
 	  mDriverVersion(0),
 	  mName(),
+	  mNumAxes(0),
+	  mAxisValues(),
+	  mNumButtons(0),
+	  mButtonValues(),
+	  mNumEventsRead(0),
+	  mHasEventTimeOffset(false),
+	  mEventTimeOffset(0),
+	  mEventTimeOffsetTime(0),
+	  mListeners()
+{
+	open( device );
+}
+
+Joystick::Joystick( int fileDescriptor, const char* name, std::size_t numAxes, std::size_t numButtons )
+	: mDeviceName(),
+	  mJoystickHandle(fileDescriptor),
+	  mDriverVersion(0),
+	  mName(name),
+	  mNumAxes(0),
 	  mAxisValues(),
-	  mButtonValues()
+	  mNumButtons(0),
+	  mButtonValues(),
+	  mNumEventsRead(0),
+	  mHasEventTimeOffset(false),
+	  mEventTimeOffset(0),
+	  mEventTimeOffsetTime(0),
+	  mListeners()
 {
-	int handle = open( device, O_RDONLY|O_NONBLOCK );
+	setNumAxesAndButtons( numAxes, numButtons );
+}
+
+Joystick::~Joystick()
+{
+	close();
+}
+
+bool Joystick::open( const char* device )
+{
+	assert( !isValid() );
+	mDeviceName = device;
+	int handle = ::open( device, O_RDONLY|O_NONBLOCK );
 	if ( handle>=0 )
 	{
 		int driverVersion = 0;
@@ -55,26 +204,38 @@ Joystick::Joystick( const char* device )
 			mJoystickHandle = handle;
 			mDriverVersion = driverVersion;
 			mName = name;
-			mAxisValues.resize(numAxes, 0);
-			mButtonValues.resize(numButtons, false);
+			setNumAxesAndButtons( static_cast<unsigned char>(numAxes), static_cast<unsigned char>(numButtons) );
+			return true;
 		}
 		else
 		{
 			printf("Can't get information for joystick %s\n", device);
-			close( handle );
+			::close( handle );
 		}
 	}
 	else
 	{
 		printf("Can't open joystick %s\n", device);
-		return;
 	}
+	return false;
 }
 
-Joystick::~Joystick()
+void Joystick::close()
 {
 	if ( isValid() )
-		close( mJoystickHandle );
+		::close( mJoystickHandle );
+	mJoystickHandle = -1;
+}
+
+// Opens the device again after it has been lost, keeping this object and its listeners.
+// The kernel sends the current state of every axis and button when a device is opened, 
+// which brings the values back in sync right away.
+bool Joystick::reopen( const char* device )
+{
+	close();
+	if ( !open( device ) )
+		return false;
+	return processEvents();
 }
 
 bool Joystick::getJoystickInfo( int handle, int& driverVersion, std::string& name, char& numAxes, char& numButtons )
@@ -111,7 +272,7 @@ short int Joystick::getAxisValue( std::size_t axisIndex ) const
 {
 	if ( !isValid() )
 		return 0;
-	if ( axisIndex>=mAxisValues.size() )
+	if ( axisIndex>=mNumAxes )
 		return 0;
 	return mAxisValues[axisIndex];
 }
@@ -120,9 +281,9 @@ bool Joystick::getButtonValue( std::size_t buttonIndex ) const
 {
 	if ( !isValid() )
 		return 0;
-	if ( buttonIndex>=mButtonValues.size() )
+	if ( buttonIndex>=mNumButtons )
 		return 0;
-	return mButtonValues[buttonIndex];
+	return (mButtonValues[buttonIndex / 8] & (1 << (buttonIndex % 8)))!=0;
 }
 
 bool Joystick::update()
@@ -137,18 +298,25 @@ bool Joystick::processEvents()
 	js_event event;
 	bool error = false;
 	bool finished = false;
+	unsigned long long readTime = 0;
 	do
 	{
 		int bytesRead = read( mJoystickHandle, &event, sizeof(js_event) );
-		if ( bytesRead!=-1 )
+		if ( bytesRead==sizeof(js_event) )
 		{
-			assert( bytesRead==sizeof(js_event) );				
+			++mNumEventsRead;
+
+			// All the events of this batch were queued by the time the first one is read
+			if ( readTime==0 )
+				readTime = TimerScheduler::getTimeAsNanoseconds() / 1000000;
+			updateEventTimeOffset( event.time, readTime );
 			processEvent( event );
 		}
 		else
 		{
+			// A read of 0 bytes means the other end is gone (can only happen with a wrapped file descriptor)
 			finished = true;
-			if ( errno!=EAGAIN )
+			if ( bytesRead!=-1 || errno!=EAGAIN )
 				error = true;
 		}
 	}
@@ -162,9 +330,52 @@ bool Joystick::processEvents()
 void Joystick::processEvent( const js_event& event )
 {
 	if ( event.type & JS_EVENT_BUTTON )
-		setButtonValue( event.number, (event.value!=0) );
+	{
+		if ( event.number>=getNumButtons() )
+			return;
+		bool value = (event.value!=0);
+		setButtonValue( event.number, value );
+
+		// Notify
+		for ( Listeners::iterator itr=mListeners.begin(); itr!=mListeners.end(); ++itr )
+			(*itr)->onButtonChanged( this, event.number, value, event.time );
+	}
 	else if ( event.type & JS_EVENT_AXIS )
+	{
+		if ( event.number>=getNumAxes() )
+			return;
 		setAxisValue( event.number, event.value );
+
+		// Notify
+		for ( Listeners::iterator itr=mListeners.begin(); itr!=mListeners.end(); ++itr )
+			(*itr)->onAxisChanged( this, event.number, event.value, event.time );
+	}
+}
+
+// An event is read some time after the driver stamped it, so its time minus the read time is at most 
+// the offset between both clocks, and closest to it for the events read with the least delay: the largest 
+// one is kept. It's let down by 1 ms per second, so that a drift between both clocks is followed.
+void Joystick::updateEventTimeOffset( unsigned int eventTime, unsigned long long readTime )
+{
+	unsigned int offset = eventTime - static_cast<unsigned int>(readTime);
+	if ( mHasEventTimeOffset )
+	{
+		// After a long while without events, start over from the new offset
+		unsigned long long decay = (readTime - mEventTimeOffsetTime) / 1000;
+		if ( decay<mMaxEventTimeOffsetDecayInMs && static_cast<int>(offset - (mEventTimeOffset - static_cast<unsigned int>(decay)))<0 )
+			return;
+	}
+	mHasEventTimeOffset = true;
+	mEventTimeOffset = offset;
+	mEventTimeOffsetTime = readTime;
+}
+
+bool Joystick::getEventTime( unsigned long long timeInMs, unsigned int& eventTimeInMs ) const
+{
+	if ( !mHasEventTimeOffset )
+		return false;
+	eventTimeInMs = static_cast<unsigned int>(timeInMs) + mEventTimeOffset;
+	return true;
 }
 
 void Joystick::setAxisValue( std::size_t axisIndex, short int value )
@@ -180,7 +391,39 @@ void Joystick::setButtonValue( std::size_t buttonIndex, bool value )
 	assert(isValid());
 	if (buttonIndex>=getNumButtons())
 		return;
-	mButtonValues[buttonIndex]=value;
+	unsigned char mask = static_cast<unsigned char>( 1 << (buttonIndex % 8) );
+	if ( value )
+		mButtonValues[buttonIndex / 8] |= mask;
+	else
+		mButtonValues[buttonIndex / 8] &= ~mask;
+}
+
+// Resets all the values to neutral
+void Joystick::setNumAxesAndButtons( std::size_t numAxes, std::size_t numButtons )
+{
+	mNumAxes = numAxes;
+	if ( mNumAxes>mMaxNumAxes )
+		mNumAxes = mMaxNumAxes;
+	mNumButtons = numButtons;
+	if ( mNumButtons>mMaxNumButtons )
+		mNumButtons = mMaxNumButtons;
+	memset( mAxisValues, 0, sizeof(mAxisValues) );
+	memset( mButtonValues, 0, sizeof(mButtonValues) );
+}
+
+void Joystick::addListener( Listener* listener )
+{
+	assert(listener);
+	mListeners.push_back(listener);
+}
+
+bool Joystick::removeListener( Listener* listener )
+{
+	Listeners::iterator itr = std::find( mListeners.begin(), mListeners.end(), listener );
+	if ( itr==mListeners.end() )
+		return false;
+	mListeners.erase( itr );
+	return true;
 }
 
 std::string Joystick::toString() const
@@ -196,4 +439,82 @@ std::string Joystick::toString() const
 	return stream.str();
 }
 
+std::size_t Joystick::toString( char* buffer, std::size_t bufferSize, Format format ) const
+{
+	StateWriter writer( buffer, bufferSize );
+	switch ( format )
+	{
+		case TextFormat:
+			writer.write( "Joystick:\ndriverVersion:" );
+			writer.write( static_cast<long>(getDriverVersion()) );
+			writer.write( "\nname:" );
+			writer.write( getName().c_str() );
+			writer.write( '\n' );
+			for ( std::size_t i=0; i<getNumAxes(); ++i )
+			{
+				writer.write( "axis #:" );
+				writer.write( static_cast<long>(i) );
+				writer.write( " value:" );
+				writer.write( static_cast<long>(getAxisValue(i)) );
+				writer.write( '\n' );
+			}
+			for ( std::size_t i=0; i<getNumButtons(); ++i )
+			{
+				writer.write( "button #:" );
+				writer.write( static_cast<long>(i) );
+				writer.write( " value:" );
+				writer.write( getButtonValue(i) ? '1' : '0' );
+				writer.write( '\n' );
+			}
+			break;
+
+		case JsonFormat:
+			writer.write( "{\"device\":" );
+			writer.writeJsonString( getDeviceName() );
+			writer.write( ",\"name\":" );
+			writer.writeJsonString( getName() );
+			writer.write( ",\"driverVersion\":" );
+			writer.write( static_cast<long>(getDriverVersion()) );
+			writer.write( ",\"axes\":[" );
+			for ( std::size_t i=0; i<getNumAxes(); ++i )
+			{
+				if ( i>0 )
+					writer.write( ',' );
+				writer.write( static_cast<long>(getAxisValue(i)) );
+			}
+			writer.write( "],\"buttons\":[" );
+			for ( std::size_t i=0; i<getNumButtons(); ++i )
+			{
+				if ( i>0 )
+					writer.write( ',' );
+				writer.write( getButtonValue(i) ? '1' : '0' );
+			}
+			writer.write( "]}" );
+			break;
+
+		case CsvFormat:
+			writer.writeCsvString( getDeviceName() );
+			writer.write( ',' );
+			writer.writeCsvString( getName() );
+			writer.write( ',' );
+			writer.write( static_cast<long>(getDriverVersion()) );
+			writer.write( ',' );
+			writer.write( static_cast<long>(getNumAxes()) );
+			for ( std::size_t i=0; i<getNumAxes(); ++i )
+			{
+				writer.write( ',' );
+				writer.write( static_cast<long>(getAxisValue(i)) );
+			}
+			writer.write( ',' );
+			writer.write( static_cast<long>(getNumButtons()) );
+			for ( std::size_t i=0; i<getNumButtons(); ++i )
+			{
+				writer.write( ',' );
+				writer.write( getButtonValue(i) ? '1' : '0' );
+			}
+			break;
+	}
+	return writer.finish();
+}
+
 }
@@ -25,16 +25,21 @@
 
 #include <assert.h>
 #include <algorithm>
-#include <sys/time.h>
 
 namespace RLJ
 {
 
 /*
-	TimeBasedEnumerationTrigger
+	JoystickEnumerationTrigger
 */
-unsigned int TimeBasedEnumerationTrigger::mInitialSecond = 0xFFFFFFFF;
+JoystickEnumerationTrigger* JoystickEnumerationTrigger::createTrigger( unsigned int intervalInMs ) const
+{
+	return new TimeBasedEnumerationTrigger( intervalInMs );
+}
 
+/*
+	TimeBasedEnumerationTrigger
+*/
 TimeBasedEnumerationTrigger::TimeBasedEnumerationTrigger( unsigned int intervalInMs )
 	: mIntervalInMs(intervalInMs),
 	  mStartTime(0),
@@ -51,7 +56,7 @@ TimeBasedEnumerationTrigger::TimeBasedEnumerationTrigger( unsigned int intervalI
 bool TimeBasedEnumerationTrigger::enumerationNeeded()
 {
 	bool ret = false;
-	unsigned int currentTime = getTimeAsMilliseconds();
+	unsigned long long currentTime = getTimeAsMilliseconds();
 	if ( currentTime>=mNextTime )
 	{
 		ret = true;
@@ -60,35 +65,68 @@ bool TimeBasedEnumerationTrigger::enumerationNeeded()
 	return ret;
 }
 
+JoystickEnumerationTrigger* TimeBasedEnumerationTrigger::createTrigger( unsigned int intervalInMs ) const
+{
+	return new TimeBasedEnumerationTrigger( intervalInMs );
+}
+
 // Return the number of intervals done since start. 
 // Returns -1 if interval was set to 0 (continuous firing)
-int TimeBasedEnumerationTrigger::updateNextTime()
+long long TimeBasedEnumerationTrigger::updateNextTime()
 {
-	int numIntervalsDone = -1;
-	unsigned int currentTime = getTimeAsMilliseconds();
+	long long numIntervalsDone = -1;
+	unsigned long long currentTime = getTimeAsMilliseconds();
 	if ( mIntervalInMs==0 )
 	{
 		mNextTime = currentTime;
 	}
 	else
 	{
-		unsigned int timeSinceStart = currentTime - mStartTime;
-		numIntervalsDone = timeSinceStart / mIntervalInMs;
+		unsigned long long timeSinceStart = currentTime - mStartTime;
+		numIntervalsDone = static_cast<long long>( timeSinceStart / mIntervalInMs );
 		assert( numIntervalsDone>=0 );
-		mNextTime = mStartTime + (static_cast<unsigned int>(numIntervalsDone) + 1) * mIntervalInMs;
+		mNextTime = mStartTime + (static_cast<unsigned long long>(numIntervalsDone) + 1) * mIntervalInMs;
 	}
 	return numIntervalsDone;
 }
 
-unsigned int TimeBasedEnumerationTrigger::getTimeAsMilliseconds()
+// The monotonic clock isn't affected by changes of the system time (NTP, manual setting...)
+unsigned long long TimeBasedEnumerationTrigger::getTimeAsMilliseconds()
+{
+	return TimerScheduler::getTimeAsNanoseconds() / 1000000;
+}
+
+/*
+	TimerEnumerationTrigger
+*/
+TimerEnumerationTrigger::TimerEnumerationTrigger( TimerScheduler& scheduler, unsigned int intervalInMs )
+	: mScheduler(scheduler),
+	  mEnumerationNeeded(true)
+{
+	// As with TimeBasedEnumerationTrigger, the first enumeration happens as soon as possible
+	mScheduler.addTask( this, intervalInMs );
+}
+
+TimerEnumerationTrigger::~TimerEnumerationTrigger()
 {
-	struct timeval p;
-	gettimeofday(&p, NULL);	// Gets the time since the Epoch (00:00:00 UTC, January 1, 1970) in sec, and microsec
-	if ( mInitialSecond==0xFFFFFFFF )
-		mInitialSecond = p.tv_sec;
-	unsigned int tickCountInMs = (p.tv_sec - mInitialSecond) * 1000 + ( p.tv_usec / 1000 );
-	return tickCountInMs;
+	mScheduler.removeTask( this );
 }
 
+bool TimerEnumerationTrigger::enumerationNeeded()
+{
+	bool ret = mEnumerationNeeded;
+	mEnumerationNeeded = false;
+	return ret;
 }
 
+JoystickEnumerationTrigger* TimerEnumerationTrigger::createTrigger( unsigned int intervalInMs ) const
+{
+	return new TimerEnumerationTrigger( mScheduler, intervalInMs );
+}
+
+void TimerEnumerationTrigger::run( TimerScheduler* /*scheduler*/ )
+{
+	mEnumerationNeeded = true;
+}
+
+}
@@ -28,8 +28,13 @@
 #include <assert.h>
 #include <algorithm>
 #include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "RLJJoystickEnumerationTrigger.h"
+#include "RLJShardedJoystickUpdater.h"
 
 /*
 	Notes:
@@ -48,7 +53,9 @@ namespace RLJ
 bool JoystickManager::JoystickIdentifier::operator==( const JoystickIdentifier& other ) const
 {
 	return	mDeviceName==other.mDeviceName && 
-			mName==other.mName;
+			mName==other.mName &&
+			mPhys==other.mPhys &&
+			mUniq==other.mUniq;
 }
 
 bool JoystickManager::JoystickIdentifier::operator!=( const JoystickIdentifier& other ) const
@@ -56,26 +63,56 @@ bool JoystickManager::JoystickIdentifier::operator!=( const JoystickIdentifier&
 	return !(*this==other);
 }
 
+// Whether both identifiers describe the same physical device, possibly 
+// reappearing under another device name
+bool JoystickManager::JoystickIdentifier::isSameDevice( const JoystickIdentifier& other ) const
+{
+	if ( mName!=other.mName )
+		return false;
+	
+	// Without physical location or unique id to tell devices apart, only trust the device name
+	if ( mPhys.empty() && mUniq.empty() && other.mPhys.empty() && other.mUniq.empty() )
+		return mDeviceName==other.mDeviceName;
+	return mPhys==other.mPhys && mUniq==other.mUniq;
+}
+
 /*
 	JoystickManager
 */
-JoystickManager::JoystickManager( const std::vector<std::string>& deviceNames ) 
+JoystickManager::JoystickManager( const std::vector<std::string>& deviceNames, std::size_t maxNumSimulatedJoysticks ) 
 	:	mEnumerationTrigger(NULL),
+		mReattachTrigger(NULL),
+		mReconnectGracePeriodInMs(0),
+		mPollingMode(FullRatePolling),
+		mPollScheduler(getTimeAsMilliseconds()),
+		mShardedUpdater(NULL),
 		mJoystickDeviceNames(deviceNames),
+		mJoystickPool(NULL),
 		mJoysticks(),
+		mJoystickHandles(),
 		mJoystickIdentifiers(),
+		mJoystickLostTimes(),
 		mListeners()
 {
 	mEnumerationTrigger = new TimeBasedEnumerationTrigger( mEnumerationIntervalInMs );
+	initializeJoystickStorage( maxNumSimulatedJoysticks );
 	//for ( std::size_t i=0; i<mJoystickDeviceNames.size(); ++i )
 	//	printf("%s\n", mJoystickDeviceNames[i].c_str());
 }
 
-JoystickManager::JoystickManager( const char* deviceNameRoot, unsigned int numDevices ) 
+JoystickManager::JoystickManager( const char* deviceNameRoot, unsigned int numDevices, std::size_t maxNumSimulatedJoysticks ) 
 	:	mEnumerationTrigger(NULL),
+		mReattachTrigger(NULL),
+		mReconnectGracePeriodInMs(0),
+		mPollingMode(FullRatePolling),
+		mPollScheduler(getTimeAsMilliseconds()),
+		mShardedUpdater(NULL),
 		mJoystickDeviceNames(),
+		mJoystickPool(NULL),
 		mJoysticks(),
+		mJoystickHandles(),
 		mJoystickIdentifiers(),
+		mJoystickLostTimes(),
 		mListeners()
 {	
 	mEnumerationTrigger = new TimeBasedEnumerationTrigger( mEnumerationIntervalInMs );
@@ -85,6 +122,7 @@ JoystickManager::JoystickManager( const char* deviceNameRoot, unsigned int numDe
 		stream << deviceNameRoot << i;
 		mJoystickDeviceNames.push_back( stream.str() );
 	}
+	initializeJoystickStorage( maxNumSimulatedJoysticks );
 
 	//for ( std::size_t i=0; i<mJoystickDeviceNames.size(); ++i )
 	//	printf("%s\n", mJoystickDeviceNames[i].c_str());
@@ -92,40 +130,211 @@ JoystickManager::JoystickManager( const char* deviceNameRoot, unsigned int numDe
 
 JoystickManager::~JoystickManager()
 {
+	delete mShardedUpdater;
+	mShardedUpdater = NULL;
+	delete mJoystickPool;
+	mJoystickPool = NULL;
+	delete mReattachTrigger;
+	mReattachTrigger = NULL;
 	delete mEnumerationTrigger;
 	mEnumerationTrigger = NULL;
 }
 
+// There can't be more joysticks than monitored device names and simulated joysticks, 
+// so all the storage is allocated once and reused as joysticks come and go
+void JoystickManager::initializeJoystickStorage( std::size_t maxNumSimulatedJoysticks )
+{
+	std::size_t capacity = mJoystickDeviceNames.size() + maxNumSimulatedJoysticks;
+	mJoystickPool = new JoystickPool( capacity );
+	mJoysticks.reserve( capacity );
+	mJoystickHandles.reserve( capacity );
+	mJoystickIdentifiers.reserve( capacity );
+	mJoystickLostTimes.reserve( capacity );
+}
+
 void JoystickManager::update()
 {
-	if ( mEnumerationTrigger->enumerationNeeded() )
+	unsigned long long currentTime = getTimeAsMilliseconds();
+	bool adaptive = (mPollingMode==AdaptivePolling);
+
+	// While some joysticks are lost, look for their return more often than usual
+	bool enumerationNeeded = adaptive ? mPollScheduler.isEnumerationDue( currentTime ) : mEnumerationTrigger->enumerationNeeded();
+	if ( enumerationNeeded || 
+		 (mReattachTrigger && mReattachTrigger->enumerationNeeded()) )
+	{
 		updateEnumeration();
+		if ( adaptive )
+			mPollScheduler.onEnumerated( currentTime );
+	}
 
-	for ( std::size_t i=0; i<mJoysticks.size(); ++i )
-		mJoysticks[i]->update();
+	if ( adaptive && !mPollScheduler.isPollDue( currentTime ) )
+		return;
+
+	// mJoysticks is in pool slot order, so both paths read the joysticks in memory order
+	bool activity = false;
+	if ( mShardedUpdater )
+	{
+		// Merge the results of all the shards
+		mShardedUpdater->update( mJoysticks );
+		const std::vector<ShardedJoystickUpdater::Result>& results = mShardedUpdater->getResults();
+		for ( std::size_t i=0; i<mJoysticks.size(); ++i )
+		{
+			if ( results[i].mReadFailed )
+				markJoystickLost( i, currentTime );
+			if ( results[i].mNumEventsRead>0 )
+				activity = true;
+		}
+	}
+	else
+	{
+		for ( std::size_t i=0; i<mJoysticks.size(); ++i )
+		{
+			Joystick* joystick = mJoysticks[i];
+			unsigned int numEventsRead = joystick->getNumEventsRead();
+			if ( joystick->isValid() && !joystick->update() )
+				markJoystickLost( i, currentTime );
+			if ( joystick->getNumEventsRead()!=numEventsRead )
+				activity = true;
+		}
+	}
+
+	if ( adaptive )
+		mPollScheduler.onPolled( currentTime, activity );
 }
 
-bool JoystickManager::getJoystickIdentifier( const char* deviceName, JoystickIdentifier& identifier )
+std::size_t JoystickManager::dumpJoysticks( char* buffer, std::size_t bufferSize, Joystick::Format format ) const
 {
-	int handle = open( deviceName, O_RDONLY|O_NONBLOCK );
-	if ( handle>=0 )
+	std::size_t length = 0;
+	for ( std::size_t i=0; i<mJoysticks.size(); ++i )
 	{
-		int driverVersion = 0;
-		std::string name;
-		char numAxes = 0; 
-		char numButtons = 0;
-		if ( Joystick::getJoystickInfo( handle, driverVersion, name, numAxes, numButtons ) )
+		// Once the buffer is full, keep going to compute the full length
+		std::size_t offset = std::min( length, bufferSize>0 ? bufferSize-1 : 0 );
+		length += mJoysticks[i]->toString( buffer + offset, bufferSize - offset, format );
+		
+		offset = std::min( length, bufferSize>0 ? bufferSize-1 : 0 );
+		if ( offset+1<bufferSize )
 		{
-			identifier.mDeviceName = deviceName;
-			identifier.mName = name;
-			return true;
+			buffer[offset] = '\n';
+			buffer[offset+1] = '\0';
 		}
+		++length;
 	}
-	return false;
+	if ( mJoysticks.empty() && bufferSize>0 )
+		buffer[0] = '\0';
+	return length;
+}
+
+void JoystickManager::setEnumerationTrigger( JoystickEnumerationTrigger* trigger )
+{
+	assert( trigger );
+	delete mEnumerationTrigger;
+	mEnumerationTrigger = trigger;
+
+	// Probe for lost joysticks the same way
+	if ( mReattachTrigger )
+	{
+		delete mReattachTrigger;
+		mReattachTrigger = mEnumerationTrigger->createTrigger( mReattachIntervalInMs );
+	}
+}
+
+void JoystickManager::setNumUpdateThreads( std::size_t numThreads )
+{
+	delete mShardedUpdater;
+	mShardedUpdater = NULL;
+	if ( numThreads>1 )
+		mShardedUpdater = new ShardedJoystickUpdater( numThreads );
+}
+
+std::size_t JoystickManager::getNumUpdateThreads() const
+{
+	if ( !mShardedUpdater )
+		return 1;
+	return mShardedUpdater->getNumThreads();
+}
+
+void JoystickManager::setPollingMode( PollingMode mode )
+{
+	mPollingMode = mode;
+	mPollScheduler.setSettings( mPollScheduler.getSettings(), getTimeAsMilliseconds() );
+}
+
+void JoystickManager::setAdaptivePollingSettings( const JoystickPollScheduler::Settings& settings )
+{
+	mPollScheduler.setSettings( settings, getTimeAsMilliseconds() );
+}
+
+bool JoystickManager::isIdle() const
+{
+	if ( mPollingMode!=AdaptivePolling )
+		return false;
+	return mPollScheduler.isIdle( getTimeAsMilliseconds() );
+}
+
+unsigned int JoystickManager::getTimeUntilNextUpdate() const
+{
+	if ( mPollingMode!=AdaptivePolling )
+		return 0;
+	
+	unsigned int timeUntilNextUpdate = mPollScheduler.getTimeUntilNextUpdate( getTimeAsMilliseconds() );
+	if ( hasLostJoysticks() && timeUntilNextUpdate>mReattachIntervalInMs )
+		timeUntilNextUpdate = mReattachIntervalInMs;
+	return timeUntilNextUpdate;
+}
+
+void JoystickManager::requestUpdate()
+{
+	mPollScheduler.requestPoll( getTimeAsMilliseconds() );
+}
+
+bool JoystickManager::getJoystickIdentifier( const char* deviceName, JoystickIdentifier& identifier )
+{
+	int handle = open( deviceName, O_RDONLY|O_NONBLOCK );
+	if ( handle<0 )
+		return false;
+	
+	int driverVersion = 0;
+	std::string name;
+	char numAxes = 0; 
+	char numButtons = 0;
+	bool ret = Joystick::getJoystickInfo( handle, driverVersion, name, numAxes, numButtons );
+	close( handle );
+	if ( !ret )
+		return false;
+
+	identifier.mDeviceName = deviceName;
+	identifier.mName = name;
+	
+	// The joystick interface doesn't provide the physical location and unique id of the 
+	// device, but sysfs does. They're left empty if not available (not a /dev/input/jsX device...)
+	const char* baseName = strrchr( deviceName, '/' );
+	baseName = baseName ? baseName+1 : deviceName;
+	std::string sysfsPath = std::string("/sys/class/input/") + baseName + "/device/";
+	identifier.mPhys = readSysfsAttribute( (sysfsPath + "phys").c_str() );
+	identifier.mUniq = readSysfsAttribute( (sysfsPath + "uniq").c_str() );
+	return true;
+}
+
+std::string JoystickManager::readSysfsAttribute( const char* path )
+{
+	FILE* file = fopen( path, "r" );
+	if ( !file )
+		return std::string();
+	char buffer[256];
+	memset( buffer, 0, sizeof(buffer) );
+	if ( !fgets( buffer, sizeof(buffer), file ) )
+		buffer[0] = '\0';
+	fclose( file );
+	std::size_t length = strlen( buffer );
+	while ( length>0 && (buffer[length-1]=='\n' || buffer[length-1]==' ') )
+		buffer[--length] = '\0';
+	return std::string( buffer );
 }
 
 void JoystickManager::updateEnumeration()
 {
+	unsigned long long currentTime = getTimeAsMilliseconds();
+
 	// Get current list of joysticks
 	std::vector<JoystickIdentifier> identifiers;
 	for ( std::size_t i=0; i<mJoystickDeviceNames.size(); ++i )
@@ -135,38 +344,53 @@ void JoystickManager::updateEnumeration()
 			identifiers.push_back( identifier );
 	}
 
-	// Identify joysticks that have been added since last enumeration
+	// Joysticks whose device has disappeared since last enumeration are lost. They're 
+	// kept for the reconnect grace period, in case the same device comes back
+	for ( std::size_t i=0; i<mJoystickIdentifiers.size(); ++i )
+	{
+		if ( mJoystickIdentifiers[i].mSimulated )
+			continue;
+		if ( mJoysticks[i]->isValid() && getJoystickIdentifierIndex( identifiers, mJoystickIdentifiers[i] )==-1 )
+			markJoystickLost( i, currentTime );
+	}
+
+	// Identify joysticks that have been added since last enumeration. Lost joysticks whose
+	// device is back are reattached instead
 	std::vector<JoystickIdentifier> joysticksToAdd;
 	for ( std::size_t i=0; i<identifiers.size(); ++i )
 	{
-		bool deviceAdded = false;
-		for ( std::size_t j=0; j<mJoystickIdentifiers.size(); ++j )
+		int index = getJoystickIdentifierIndex( mJoystickIdentifiers, identifiers[i] );
+		if ( index!=-1 )
 		{
-			if ( identifiers[i]==mJoystickIdentifiers[j] )
+			// Past the grace period, the lost joystick is removed below and the device added back as a new one
+			if ( !mJoysticks[index]->isValid() )
 			{
-				deviceAdded = true;
-				break;
+				if ( isInGracePeriod( index, currentTime ) )
+					reattachJoystick( index, identifiers[i] );
+				else
+					joysticksToAdd.push_back( identifiers[i] );
 			}
+			continue;
 		}
-		if ( !deviceAdded )
+
+		index = getLostJoystickIndex( identifiers[i], currentTime );
+		if ( index!=-1 )
+			reattachJoystick( index, identifiers[i] );
+		else
 			joysticksToAdd.push_back( identifiers[i] );
 	}
 	
-	// Identify joysticks that have been removed since last enumeration
-	std::vector<JoystickIdentifier> joysticksToRemove;
+	// Identify joysticks that have been removed: lost for longer than the grace period, 
+	// or lost and whose device name is now used by another device. The latter frees 
+	// the slot the other device needs, as the pool only has one per device name
+	std::vector<std::size_t> joysticksToRemove;
 	for ( std::size_t i=0; i<mJoystickIdentifiers.size(); ++i )
 	{
-		bool deviceRemoved = true;
-		for ( std::size_t j=0; j<identifiers.size(); ++j )
-		{
-			if ( identifiers[j]==mJoystickIdentifiers[i] )
-			{
-				deviceRemoved = false;
-				break;
-			}
-		}
-		if ( deviceRemoved )
-			joysticksToRemove.push_back( mJoystickIdentifiers[i] );
+		if ( mJoysticks[i]->isValid() )
+			continue;
+		if ( isInGracePeriod( i, currentTime ) && !isDeviceNameTaken( identifiers, mJoystickIdentifiers[i] ) )
+			continue;
+		joysticksToRemove.push_back( i );
 	}
 
 /*	printf("\nDetected: \n");
@@ -177,26 +401,149 @@ void JoystickManager::updateEnumeration()
 		printf("%s\n", joysticksToAdd[i].mDeviceName.c_str());
 	printf("To remove: \n");
 	for ( std::size_t i=0; i<joysticksToRemove.size(); ++i )
-		printf("%s\n", joysticksToRemove[i].mDeviceName.c_str());
+		printf("%s\n", mJoystickIdentifiers[joysticksToRemove[i]].mDeviceName.c_str());
 	printf("\n");
 */
 
+	// Remove first, so a device replaced by another one frees its slot before the new one takes it.
+	// Removing by index, from the back so the other indices stay valid, as two joysticks can have 
+	// the same identifier (a lost simulated joystick and a new one that got the same file descriptor)
+	for ( std::size_t i=joysticksToRemove.size(); i>0; --i )
+		removeJoystick( joysticksToRemove[i-1] );
 	for ( std::size_t i=0; i<joysticksToAdd.size(); ++i )
 		addJoystick( joysticksToAdd[i] );
-	for ( std::size_t i=0; i<joysticksToRemove.size(); ++i )
-		removeJoystick( joysticksToRemove[i] );
+
+	// Stop probing once no joystick is lost anymore
+	if ( mReattachTrigger && !hasLostJoysticks() )
+	{
+		delete mReattachTrigger;
+		mReattachTrigger = NULL;
+	}
+}
+
+bool JoystickManager::hasLostJoysticks() const
+{
+	for ( std::size_t i=0; i<mJoysticks.size(); ++i )
+	{
+		if ( !mJoysticks[i]->isValid() )
+			return true;
+	}
+	return false;
+}
+
+void JoystickManager::markJoystickLost( std::size_t index, unsigned long long currentTime )
+{
+	// Closing the device makes the joystick report neutral values until it's reattached
+	mJoysticks[index]->close();
+	mJoystickLostTimes[index] = currentTime;
+
+	// Probe for the lost joysticks with a trigger of the same kind as the enumeration one, 
+	// so a caller waiting on a TimerScheduler is woken up for it too
+	if ( !mReattachTrigger )
+		mReattachTrigger = mEnumerationTrigger->createTrigger( mReattachIntervalInMs );
+}
+
+// A grace period of 0 means lost joysticks are never reattached
+bool JoystickManager::isInGracePeriod( std::size_t index, unsigned long long currentTime ) const
+{
+	return currentTime - mJoystickLostTimes[index] < mReconnectGracePeriodInMs;
+}
+
+// Returns the index of a lost joystick, still in its grace period, that is the same 
+// device as the given one, or -1
+int JoystickManager::getLostJoystickIndex( const JoystickIdentifier& identifier, unsigned long long currentTime ) const
+{
+	for ( std::size_t i=0; i<mJoystickIdentifiers.size(); ++i )
+	{
+		if ( !mJoysticks[i]->isValid() && isInGracePeriod( i, currentTime ) && mJoystickIdentifiers[i].isSameDevice( identifier ) )
+			return i;
+	}
+	return -1;
+}
+
+bool JoystickManager::reattachJoystick( std::size_t index, const JoystickIdentifier& identifier )
+{
+	Joystick* joystick = mJoysticks[index];
+	if ( !joystick->reopen( identifier.mDeviceName.c_str() ) )
+	{
+		joystick->close();
+		return false;
+	}
+	mJoystickIdentifiers[index] = identifier;
+	//printf("reattached %s\n", identifier.mDeviceName.c_str());
+
+	// Notify
+	for ( Listeners::iterator itr=mListeners.begin(); itr!=mListeners.end(); ++itr )
+		(*itr)->onJoystickReconnected( this, mJoystickHandles[index] );
+	return true;
+}
+
+// Same monotonic clock as TimerScheduler, on 64 bits so it doesn't wrap
+unsigned long long JoystickManager::getTimeAsMilliseconds()
+{
+	return TimerScheduler::getTimeAsNanoseconds() / 1000000;
 }
 
 void JoystickManager::addJoystick( const JoystickIdentifier& identifier )
 {
-	mJoystickIdentifiers.push_back( identifier );
-	Joystick* joystick = new Joystick( identifier.mDeviceName.c_str() );
-	mJoysticks.push_back( joystick );
+	JoystickHandle handle = mJoystickPool->create( identifier.mDeviceName.c_str() );
+	if ( handle.isNull() )
+	{
+		printf("Can't add joystick %s, no free slot\n", identifier.mDeviceName.c_str());
+		return;
+	}
+	insertJoystick( identifier, handle );
 	//printf("added %s\n", identifier.mDeviceName.c_str());
+}
+
+JoystickHandle JoystickManager::addSimulatedJoystick( int fileDescriptor, const char* name, std::size_t numAxes, std::size_t numButtons )
+{
+	// The file descriptor makes a unique device name as long as the joystick exists
+	JoystickIdentifier identifier;
+	std::stringstream stream;
+	stream << "simulated:" << fileDescriptor;
+	identifier.mDeviceName = stream.str();
+	identifier.mName = name;
+	identifier.mSimulated = true;
+
+	JoystickHandle handle = mJoystickPool->create( fileDescriptor, name, numAxes, numButtons );
+	if ( handle.isNull() )
+	{
+		printf("Can't add simulated joystick %s, no free slot\n", name);
+		return handle;
+	}
+	insertJoystick( identifier, handle );
+	return handle;
+}
+
+void JoystickManager::insertJoystick( const JoystickIdentifier& identifier, const JoystickHandle& handle )
+{
+	Joystick* joystick = mJoystickPool->get( handle );
+	assert( joystick );
+
+	// Keep the joysticks in slot order, so going through them walks the pool front to back
+	std::size_t i = 0;
+	while ( i<mJoystickHandles.size() && mJoystickHandles[i].mIndex<handle.mIndex )
+		++i;
+	mJoystickIdentifiers.insert( mJoystickIdentifiers.begin() + i, identifier );
+	mJoysticks.insert( mJoysticks.begin() + i, joystick );
+	mJoystickHandles.insert( mJoystickHandles.begin() + i, handle );
+	mJoystickLostTimes.insert( mJoystickLostTimes.begin() + i, getTimeAsMilliseconds() );
 
 	// Notify
 	for ( Listeners::iterator itr=mListeners.begin(); itr!=mListeners.end(); ++itr )
-		(*itr)->onJoystickConnected( this, joystick );
+		(*itr)->onJoystickConnected( this, handle );
+}
+
+// Whether another device than the given one is found under its device name
+bool JoystickManager::isDeviceNameTaken( const std::vector<JoystickIdentifier>& identifiers, const JoystickIdentifier& identifier )
+{
+	for ( std::size_t i=0; i<identifiers.size(); ++i )
+	{
+		if ( identifiers[i].mDeviceName==identifier.mDeviceName && identifiers[i]!=identifier )
+			return true;
+	}
+	return false;
 }
 
 int JoystickManager::getJoystickIdentifierIndex( const std::vector<JoystickIdentifier>& identifiers, const JoystickIdentifier& identifier )
@@ -209,22 +556,20 @@ int JoystickManager::getJoystickIdentifierIndex( const std::vector<JoystickIdent
 	return -1;	
 }
 
-void JoystickManager::removeJoystick( const JoystickIdentifier& identifier )
+void JoystickManager::removeJoystick( std::size_t index )
 {
-	std::size_t i = getJoystickIdentifierIndex(mJoystickIdentifiers, identifier);
-	assert( i!=-1 );
-	
-	Joystick* joystick = mJoysticks[i];
-	
+	assert( index<mJoysticks.size() );
+
 	// Notify
 	for ( Listeners::iterator itr=mListeners.begin(); itr!=mListeners.end(); ++itr )
-		(*itr)->onJoystickDisconnecting( this, joystick );
+		(*itr)->onJoystickDisconnecting( this, mJoystickHandles[index] );
 
-	mJoystickIdentifiers.erase( mJoystickIdentifiers.begin() + i );
-	mJoysticks.erase( mJoysticks.begin() + i );
-	delete joystick;
-	joystick = NULL;
-	//printf("removed %s\n", identifier.mDeviceName.c_str());
+	//printf("removed %s\n", mJoystickIdentifiers[index].mDeviceName.c_str());
+	mJoystickIdentifiers.erase( mJoystickIdentifiers.begin() + index );
+	mJoysticks.erase( mJoysticks.begin() + index );
+	mJoystickPool->destroy( mJoystickHandles[index] );
+	mJoystickHandles.erase( mJoystickHandles.begin() + index );
+	mJoystickLostTimes.erase( mJoystickLostTimes.begin() + index );
 }
 
 void JoystickManager::addListener( Listener* listener )
@@ -0,0 +1,104 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystickPollScheduler.h"
+
+#include <algorithm>
+
+namespace RLJ
+{
+
+/*
+	JoystickPollScheduler::Settings
+*/
+JoystickPollScheduler::Settings::Settings()
+	: mActivePollIntervalInMs(4),
+	  mIdlePollIntervalInMs(100),
+	  mIdleTimeoutInMs(5000),
+	  mActiveEnumerationIntervalInMs(2000),
+	  mIdleEnumerationIntervalInMs(10000)
+{
+}
+
+/*
+	JoystickPollScheduler
+*/
+JoystickPollScheduler::JoystickPollScheduler( unsigned long long currentTime, const Settings& settings )
+	: mSettings(settings),
+	  mLastActivityTime(currentTime),
+	  mPollIntervalInMs(settings.mActivePollIntervalInMs),
+	  mNextPollTime(currentTime),
+	  mNextEnumerationTime(currentTime)
+{
+	// As with TimeBasedEnumerationTrigger, the first enumeration happens as soon as possible
+}
+
+void JoystickPollScheduler::setSettings( const Settings& settings, unsigned long long currentTime )
+{
+	mSettings = settings;
+	mLastActivityTime = currentTime;
+	mPollIntervalInMs = mSettings.mActivePollIntervalInMs;
+	mNextPollTime = currentTime;
+	mNextEnumerationTime = currentTime;
+}
+
+bool JoystickPollScheduler::isIdle( unsigned long long currentTime ) const
+{
+	return currentTime - mLastActivityTime >= mSettings.mIdleTimeoutInMs;
+}
+
+void JoystickPollScheduler::onPolled( unsigned long long currentTime, bool activity )
+{
+	if ( activity )
+	{
+		// Snap back to full rate, and bring the enumeration forward if it was pushed back while idle
+		bool wasIdle = isIdle( currentTime );
+		mLastActivityTime = currentTime;
+		mPollIntervalInMs = mSettings.mActivePollIntervalInMs;
+		if ( wasIdle && currentTime + mSettings.mActiveEnumerationIntervalInMs<mNextEnumerationTime )
+			mNextEnumerationTime = currentTime + mSettings.mActiveEnumerationIntervalInMs;
+	}
+	else if ( isIdle( currentTime ) )
+	{
+		// Back off
+		unsigned int interval = std::max( mPollIntervalInMs, 1u ) * 2;
+		mPollIntervalInMs = std::min( interval, std::max( mSettings.mIdlePollIntervalInMs, mSettings.mActivePollIntervalInMs ) );
+	}
+	mNextPollTime = currentTime + mPollIntervalInMs;
+}
+
+void JoystickPollScheduler::onEnumerated( unsigned long long currentTime )
+{
+	unsigned int interval = isIdle( currentTime ) ? mSettings.mIdleEnumerationIntervalInMs : mSettings.mActiveEnumerationIntervalInMs;
+	mNextEnumerationTime = currentTime + interval;
+}
+
+unsigned int JoystickPollScheduler::getTimeUntilNextUpdate( unsigned long long currentTime ) const
+{
+	unsigned long long nextTime = std::min( mNextPollTime, mNextEnumerationTime );
+	if ( currentTime>=nextTime )
+		return 0;
+	return static_cast<unsigned int>( nextTime - currentTime );
+}
+
+}
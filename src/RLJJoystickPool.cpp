@@ -0,0 +1,146 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystickPool.h"
+
+#include "RLJJoystick.h"
+#include <assert.h>
+#include <new>
+
+namespace RLJ
+{
+
+/*
+	JoystickPool
+
+	Each slot has a generation counter which is incremented when a joystick is 
+	created in it and again when it's destroyed. It's therefore odd while the 
+	slot holds a live joystick, and a handle is only valid if its generation 
+	matches the current one of its slot.
+*/
+JoystickPool::JoystickPool( std::size_t capacity )
+	: mCapacity(capacity),
+	  mJoysticks(NULL),
+	  mGenerations(capacity, 0),
+	  mFreeIndices()
+{
+	mJoysticks = static_cast<Joystick*>( ::operator new( mCapacity * sizeof(Joystick) ) );
+
+	// Free slots are taken from the back, so the first joystick goes in slot 0
+	mFreeIndices.reserve( mCapacity );
+	for ( std::size_t i=mCapacity; i>0; --i )
+		mFreeIndices.push_back( i-1 );
+}
+
+JoystickPool::~JoystickPool()
+{
+	destroyAll();
+	::operator delete( mJoysticks );
+	mJoysticks = NULL;
+}
+
+JoystickHandle JoystickPool::create( const char* device )
+{
+	if ( mFreeIndices.empty() )
+		return JoystickHandle();
+
+	std::size_t index = takeFreeIndex();
+	new (&mJoysticks[index]) Joystick( device );
+	return makeLive( index );
+}
+
+JoystickHandle JoystickPool::create( int fileDescriptor, const char* name, std::size_t numAxes, std::size_t numButtons )
+{
+	if ( mFreeIndices.empty() )
+		return JoystickHandle();
+
+	std::size_t index = takeFreeIndex();
+	new (&mJoysticks[index]) Joystick( fileDescriptor, name, numAxes, numButtons );
+	return makeLive( index );
+}
+
+std::size_t JoystickPool::takeFreeIndex()
+{
+	assert( !mFreeIndices.empty() );
+	std::size_t index = mFreeIndices.back();
+	mFreeIndices.pop_back();
+	return index;
+}
+
+JoystickHandle JoystickPool::makeLive( std::size_t index )
+{
+	++mGenerations[index];
+	assert( (mGenerations[index] & 1)==1 );
+	return JoystickHandle( static_cast<unsigned int>(index), mGenerations[index] );
+}
+
+bool JoystickPool::destroy( const JoystickHandle& handle )
+{
+	Joystick* joystick = get( handle );
+	if ( !joystick )
+		return false;
+
+	joystick->~Joystick();
+	++mGenerations[handle.mIndex];
+	mFreeIndices.push_back( handle.mIndex );
+	return true;
+}
+
+void JoystickPool::destroyAll()
+{
+	for ( std::size_t i=0; i<mCapacity; ++i )
+	{
+		if ( (mGenerations[i] & 1)==1 )
+			destroy( JoystickHandle( static_cast<unsigned int>(i), mGenerations[i] ) );
+	}
+}
+
+Joystick* JoystickPool::get( const JoystickHandle& handle ) const
+{
+	if ( handle.isNull() || handle.mIndex>=mCapacity )
+		return NULL;
+	if ( mGenerations[handle.mIndex]!=handle.mGeneration )
+		return NULL;
+	return &mJoysticks[handle.mIndex];
+}
+
+JoystickHandle JoystickPool::getHandle( const Joystick* joystick ) const
+{
+	if ( joystick<mJoysticks || joystick>=mJoysticks + mCapacity )
+		return JoystickHandle();
+	std::size_t index = joystick - mJoysticks;
+	if ( (mGenerations[index] & 1)==0 )
+		return JoystickHandle();
+	return JoystickHandle( static_cast<unsigned int>(index), mGenerations[index] );
+}
+
+Joystick* JoystickPool::getJoystickAt( std::size_t index ) const
+{
+	if ( index>=mCapacity )
+		return NULL;
+	if ( (mGenerations[index] & 1)==0 )
+		return NULL;
+	return &mJoysticks[index];
+}
+
+}
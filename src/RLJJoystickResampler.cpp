@@ -0,0 +1,210 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJJoystickResampler.h"
+
+#include <assert.h>
+
+namespace RLJ
+{
+
+/*
+	JoystickResampler::History
+*/
+JoystickResampler::History::History()
+	: mEvents(),
+	  mStart(0),
+	  mSize(0)
+{
+}
+
+void JoystickResampler::History::setCapacity( std::size_t capacity )
+{
+	assert( capacity>0 );
+	Event event;
+	event.mTime = 0;
+	event.mValue = 0;
+	mEvents.assign( capacity, event );
+	clear();
+}
+
+void JoystickResampler::History::push( unsigned int time, short int value )
+{
+	// Keep the history ordered even if the driver hands out an out-of-order timestamp
+	if ( mSize>0 && isBefore(time, back().mTime) )
+		time = back().mTime;
+
+	std::size_t index = 0;
+	if ( mSize<mEvents.size() )
+	{
+		index = (mStart + mSize) % mEvents.size();
+		++mSize;
+	}
+	else
+	{
+		// Full, overwrite the oldest event
+		index = mStart;
+		mStart = (mStart + 1) % mEvents.size();
+	}
+	mEvents[index].mTime = time;
+	mEvents[index].mValue = value;
+}
+
+// Returns the index of the last event whose time is at or before the given time,
+// or size() if all the events are after it (or there's none)
+std::size_t JoystickResampler::History::findLastAtOrBefore( unsigned int time ) const
+{
+	if ( mSize==0 || isBefore(time, (*this)[0].mTime) )
+		return mSize;
+
+	// Binary search for the first event strictly after the time
+	std::size_t low = 1;
+	std::size_t high = mSize;
+	while ( low<high )
+	{
+		std::size_t middle = low + (high - low) / 2;
+		if ( isBefore(time, (*this)[middle].mTime) )
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low - 1;
+}
+
+/*
+	JoystickResampler
+*/
+JoystickResampler::JoystickResampler( std::size_t numAxes, std::size_t numButtons, std::size_t historySize )
+	: mHistorySize(historySize),
+	  mAxisHistories(numAxes),
+	  mButtonHistories(numButtons)
+{
+	if ( mHistorySize==0 )
+		mHistorySize = 1;
+	for ( std::size_t i=0; i<mAxisHistories.size(); ++i )
+		mAxisHistories[i].setCapacity( mHistorySize );
+	for ( std::size_t i=0; i<mButtonHistories.size(); ++i )
+		mButtonHistories[i].setCapacity( mHistorySize );
+}
+
+JoystickResampler::~JoystickResampler()
+{
+}
+
+void JoystickResampler::addAxisValue( std::size_t axisIndex, short int value, unsigned int timeInMs )
+{
+	if ( axisIndex>=getNumAxes() )
+		return;
+	mAxisHistories[axisIndex].push( timeInMs, value );
+}
+
+void JoystickResampler::addButtonValue( std::size_t buttonIndex, bool value, unsigned int timeInMs )
+{
+	if ( buttonIndex>=getNumButtons() )
+		return;
+	mButtonHistories[buttonIndex].push( timeInMs, value ? 1 : 0 );
+}
+
+void JoystickResampler::clear()
+{
+	for ( std::size_t i=0; i<mAxisHistories.size(); ++i )
+		mAxisHistories[i].clear();
+	for ( std::size_t i=0; i<mButtonHistories.size(); ++i )
+		mButtonHistories[i].clear();
+}
+
+short int JoystickResampler::getAxisValue( std::size_t axisIndex, unsigned int timeInMs, Interpolation interpolation ) const
+{
+	if ( axisIndex>=getNumAxes() )
+		return 0;
+	return getValue( mAxisHistories[axisIndex], timeInMs, interpolation );
+}
+
+bool JoystickResampler::getButtonValue( std::size_t buttonIndex, unsigned int timeInMs ) const
+{
+	if ( buttonIndex>=getNumButtons() )
+		return false;
+	return getValue( mButtonHistories[buttonIndex], timeInMs, Hold )!=0;
+}
+
+void JoystickResampler::sample( const unsigned int* timesInMs, std::size_t numTimes, 
+								short int* axisValues, bool* buttonValues, Interpolation interpolation ) const
+{
+	std::size_t numAxes = getNumAxes();
+	std::size_t numButtons = getNumButtons();
+	for ( std::size_t i=0; i<numTimes; ++i )
+	{
+		unsigned int time = timesInMs[i];
+		if ( axisValues )
+		{
+			for ( std::size_t j=0; j<numAxes; ++j )
+				axisValues[i*numAxes + j] = getValue( mAxisHistories[j], time, interpolation );
+		}
+		if ( buttonValues )
+		{
+			for ( std::size_t j=0; j<numButtons; ++j )
+				buttonValues[i*numButtons + j] = getValue( mButtonHistories[j], time, Hold )!=0;
+		}
+	}
+}
+
+void JoystickResampler::onAxisChanged( Joystick* /*joystick*/, std::size_t axisIndex, short int value, unsigned int timeInMs )
+{
+	addAxisValue( axisIndex, value, timeInMs );
+}
+
+void JoystickResampler::onButtonChanged( Joystick* /*joystick*/, std::size_t buttonIndex, bool value, unsigned int timeInMs )
+{
+	addButtonValue( buttonIndex, value, timeInMs );
+}
+
+// Compares two wrapping millisecond timestamps
+bool JoystickResampler::isBefore( unsigned int time1, unsigned int time2 )
+{
+	return static_cast<int>(time1 - time2)<0;
+}
+
+short int JoystickResampler::getValue( const History& history, unsigned int timeInMs, Interpolation interpolation )
+{
+	if ( history.size()==0 )
+		return 0;
+
+	std::size_t index = history.findLastAtOrBefore( timeInMs );
+	if ( index==history.size() )
+		return history[0].mValue;
+	
+	const Event& event = history[index];
+	if ( interpolation==Hold || index+1==history.size() )
+		return event.mValue;
+
+	const Event& nextEvent = history[index+1];
+	unsigned int duration = nextEvent.mTime - event.mTime;
+	if ( duration==0 )
+		return nextEvent.mValue;
+	unsigned int elapsed = timeInMs - event.mTime;
+	int delta = static_cast<int>(nextEvent.mValue) - static_cast<int>(event.mValue);
+	long long value = static_cast<long long>(event.mValue) + static_cast<long long>(delta) * elapsed / duration;
+	return static_cast<short int>(value);
+}
+
+}
@@ -0,0 +1,188 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJShardedJoystickUpdater.h"
+
+#include "RLJJoystick.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+namespace RLJ
+{
+
+ShardedJoystickUpdater::ShardedJoystickUpdater( std::size_t numThreads )
+	: mShards(NULL),
+	  mNumShards(0),
+	  mThreads(),
+	  mJoysticks(NULL),
+	  mResults(),
+	  mFrame(0),
+	  mNumShardsDone(0),
+	  mQuit(false)
+{
+	if ( numThreads==0 )
+		numThreads = 1;
+	void* shards = NULL;
+	if ( posix_memalign( &shards, mCacheLineSize, numThreads * sizeof(Shard) )!=0 )
+		throw std::bad_alloc();
+	mShards = static_cast<Shard*>(shards);
+	mNumShards = numThreads;
+	memset( mShards, 0, mNumShards * sizeof(Shard) );
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mStartCondition, NULL );
+	pthread_cond_init( &mDoneCondition, NULL );
+
+	// Shard 0 belongs to the calling thread
+	mThreads.resize( numThreads-1 );
+	for ( std::size_t i=0; i<mThreads.size(); ++i )
+	{
+		Thread& thread = mThreads[i];
+		thread.mUpdater = this;
+		thread.mShardIndex = i+1;
+		if ( pthread_create( &thread.mThread, NULL, threadEntry, &thread )!=0 )
+		{
+			printf("Can't create joystick update thread\n");
+			mThreads.resize( i );
+			mNumShards = i+1;
+			break;
+		}
+	}
+}
+
+ShardedJoystickUpdater::~ShardedJoystickUpdater()
+{
+	pthread_mutex_lock( &mMutex );
+	mQuit = true;
+	pthread_cond_broadcast( &mStartCondition );
+	pthread_mutex_unlock( &mMutex );
+	for ( std::size_t i=0; i<mThreads.size(); ++i )
+		pthread_join( mThreads[i].mThread, NULL );
+
+	pthread_cond_destroy( &mDoneCondition );
+	pthread_cond_destroy( &mStartCondition );
+	pthread_mutex_destroy( &mMutex );
+
+	free( mShards );
+	mShards = NULL;
+}
+
+void ShardedJoystickUpdater::update( const std::vector<Joystick*>& joysticks )
+{
+	std::size_t numJoysticks = joysticks.size();
+	mResults.resize( numJoysticks );
+	if ( numJoysticks==0 )
+		return;
+	
+	mJoysticks = &joysticks[0];
+
+	// Contiguous shards of (nearly) equal size
+	std::size_t numShards = mNumShards;
+	for ( std::size_t i=0; i<numShards; ++i )
+	{
+		mShards[i].mBegin = i * numJoysticks / numShards;
+		mShards[i].mEnd = (i+1) * numJoysticks / numShards;
+		mShards[i].mNext = mShards[i].mBegin;
+	}
+
+	if ( numShards==1 )
+	{
+		processShards( 0 );
+		return;
+	}
+
+	// The mutex makes the shards visible to the threads, and their results visible back to us
+	pthread_mutex_lock( &mMutex );
+	++mFrame;
+	mNumShardsDone = 0;
+	pthread_cond_broadcast( &mStartCondition );
+	pthread_mutex_unlock( &mMutex );
+
+	processShards( 0 );
+
+	pthread_mutex_lock( &mMutex );
+	++mNumShardsDone;
+	while ( mNumShardsDone<numShards )
+		pthread_cond_wait( &mDoneCondition, &mMutex );
+	pthread_mutex_unlock( &mMutex );
+}
+
+void* ShardedJoystickUpdater::threadEntry( void* data )
+{
+	Thread* thread = static_cast<Thread*>(data);
+	thread->mUpdater->runThread( thread->mShardIndex );
+	return NULL;
+}
+
+void ShardedJoystickUpdater::runThread( std::size_t shardIndex )
+{
+	// The thread may only get to run after the first frames have been started, 
+	// so it starts from the frame the updater was created with rather than the current one
+	pthread_mutex_lock( &mMutex );
+	unsigned int frame = 0;
+	for ( ;; )
+	{
+		while ( mFrame==frame && !mQuit )
+			pthread_cond_wait( &mStartCondition, &mMutex );
+		if ( mQuit )
+			break;
+		frame = mFrame;
+		pthread_mutex_unlock( &mMutex );
+
+		processShards( shardIndex );
+
+		pthread_mutex_lock( &mMutex );
+		if ( ++mNumShardsDone==mNumShards )
+			pthread_cond_signal( &mDoneCondition );
+	}
+	pthread_mutex_unlock( &mMutex );
+}
+
+// Work through our own shard first, then steal from the others
+void ShardedJoystickUpdater::processShards( std::size_t shardIndex )
+{
+	std::size_t numShards = mNumShards;
+	for ( std::size_t i=0; i<numShards; ++i )
+	{
+		Shard& shard = mShards[ (shardIndex + i) % numShards ];
+		for ( ;; )
+		{
+			std::size_t index = __sync_fetch_and_add( &shard.mNext, 1 );
+			if ( index>=shard.mEnd )
+				break;
+			updateJoystick( mJoysticks[index], mResults[index] );
+		}
+	}
+}
+
+void ShardedJoystickUpdater::updateJoystick( Joystick* joystick, Result& result )
+{
+	unsigned int numEventsRead = joystick->getNumEventsRead();
+	result.mReadFailed = joystick->isValid() && !joystick->update();
+	result.mNumEventsRead = joystick->getNumEventsRead() - numEventsRead;
+}
+
+}
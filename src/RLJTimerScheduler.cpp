@@ -0,0 +1,190 @@
+/*
+   The MIT License (MIT) (http://opensource.org/licenses/MIT)
+   
+   Copyright (c) 2015 Jacques Menuet
+   
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+#include "RLJTimerScheduler.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+namespace RLJ
+{
+
+TimerScheduler::TimerScheduler()
+	: mTimerHandle(-1),
+	  mTasks(),
+	  mDispatching(false)
+{
+	mTimerHandle = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC );
+	if ( mTimerHandle<0 )
+	{
+		printf("Can't create timer (errno %d)\n", errno);
+		mTimerHandle = -1;
+	}
+}
+
+TimerScheduler::~TimerScheduler()
+{
+	if ( isValid() )
+		close( mTimerHandle );
+}
+
+bool TimerScheduler::isValid() const
+{
+	return mTimerHandle!=-1;
+}
+
+bool TimerScheduler::addTask( Task* task, unsigned int periodInMs )
+{
+	assert( task );
+	assert( !mDispatching );
+	if ( periodInMs==0 )
+		return false;
+	for ( std::size_t i=0; i<mTasks.size(); ++i )
+	{
+		if ( mTasks[i].mTask==task )
+			return false;
+	}
+
+	ScheduledTask scheduledTask;
+	scheduledTask.mTask = task;
+	scheduledTask.mPeriodInNs = static_cast<unsigned long long>(periodInMs) * 1000000;
+	scheduledTask.mStartTime = getTimeAsNanoseconds();
+	scheduledTask.mNextTime = scheduledTask.mStartTime + scheduledTask.mPeriodInNs;
+	mTasks.push_back( scheduledTask );
+	armTimer();
+	return true;
+}
+
+bool TimerScheduler::removeTask( Task* task )
+{
+	assert( !mDispatching );
+	for ( std::size_t i=0; i<mTasks.size(); ++i )
+	{
+		if ( mTasks[i].mTask==task )
+		{
+			mTasks.erase( mTasks.begin() + i );
+			armTimer();
+			return true;
+		}
+	}
+	return false;
+}
+
+std::size_t TimerScheduler::dispatch()
+{
+	// Acknowledge the expiration, if any, so the file descriptor isn't readable anymore
+	if ( isValid() )
+	{
+		uint64_t numExpirations = 0;
+		if ( read( mTimerHandle, &numExpirations, sizeof(numExpirations) )<0 && errno!=EAGAIN )
+			printf("Can't read timer (errno %d)\n", errno);
+	}
+
+	std::size_t numTasksRun = 0;
+	unsigned long long currentTime = getTimeAsNanoseconds();
+	mDispatching = true;
+	for ( std::size_t i=0; i<mTasks.size(); ++i )
+	{
+		ScheduledTask& scheduledTask = mTasks[i];
+		if ( currentTime<scheduledTask.mNextTime )
+			continue;
+		
+		// Skip the periods that have been missed
+		unsigned long long numPeriodsDone = (currentTime - scheduledTask.mStartTime) / scheduledTask.mPeriodInNs;
+		scheduledTask.mNextTime = scheduledTask.mStartTime + (numPeriodsDone + 1) * scheduledTask.mPeriodInNs;
+		scheduledTask.mTask->run( this );
+		++numTasksRun;
+	}
+	mDispatching = false;
+
+	armTimer();
+	return numTasksRun;
+}
+
+int TimerScheduler::getTimeUntilNextTask() const
+{
+	unsigned long long nextTime = 0;
+	if ( !getNextTime( nextTime ) )
+		return -1;
+	unsigned long long currentTime = getTimeAsNanoseconds();
+	if ( nextTime<=currentTime )
+		return 0;
+
+	// Round up, so waiting that long makes the task due. Clamp to INT_MAX so a long
+	// period isn't mistaken for -1 (no task), nor makes poll() wait forever
+	unsigned long long timeUntilNextTask = (nextTime - currentTime + 999999) / 1000000;
+	if ( timeUntilNextTask>static_cast<unsigned long long>(INT_MAX) )
+		return INT_MAX;
+	return static_cast<int>( timeUntilNextTask );
+}
+
+unsigned long long TimerScheduler::getTimeAsNanoseconds()
+{
+	struct timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return static_cast<unsigned long long>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+bool TimerScheduler::getNextTime( unsigned long long& nextTime ) const
+{
+	if ( mTasks.empty() )
+		return false;
+	nextTime = mTasks[0].mNextTime;
+	for ( std::size_t i=1; i<mTasks.size(); ++i )
+	{
+		if ( mTasks[i].mNextTime<nextTime )
+			nextTime = mTasks[i].mNextTime;
+	}
+	return true;
+}
+
+// Arms the timer for the earliest task, or disarms it if there's none
+void TimerScheduler::armTimer()
+{
+	if ( !isValid() )
+		return;
+
+	struct itimerspec timerSpec;
+	memset( &timerSpec, 0, sizeof(timerSpec) );
+	unsigned long long nextTime = 0;
+	if ( getNextTime( nextTime ) )
+	{
+		timerSpec.it_value.tv_sec = static_cast<time_t>( nextTime / 1000000000 );
+		timerSpec.it_value.tv_nsec = static_cast<long>( nextTime % 1000000000 );
+		
+		// A zero time would disarm the timer
+		if ( timerSpec.it_value.tv_sec==0 && timerSpec.it_value.tv_nsec==0 )
+			timerSpec.it_value.tv_nsec = 1;
+	}
+	if ( timerfd_settime( mTimerHandle, TFD_TIMER_ABSTIME, &timerSpec, NULL )<0 )
+		printf("Can't set timer (errno %d)\n", errno);
+}
+
+}